@@ -14,16 +14,252 @@
 #include "threading/src/threading/RecursiveLevelCounter.h"
 #include "threading/src/threading/lock_functional.h"
 #include <cassert>
+#include <algorithm>
 #include <vector>
 #include <atomic>
 #include <memory>
 #include <mutex>
 #include <thread>
+#include <chrono>
+#include <optional>
+#include <functional>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <type_traits>
+
+#if defined(__unix__) || defined(__APPLE__)
+    #include <sys/mman.h>
+    #define SYNCED_CHUNKED_ARRAY_MADVISE
+#endif
+#include <limits>
+
+/// Compile-time customization points of SyncedChunkedArray.
+/// Derive from it, and hide what you need:
+///
+///     struct MyPolicy : SyncedChunkedArrayPolicy {
+///         template<class T, class Iterator>
+///         static void on_relocate(T &element, const Iterator &from, const Iterator &to) {
+///             element.index->update(element.key, to);
+///         }
+///     };
+///     SyncedChunkedArray<MyData, 128, MyPolicy> list;
+struct SyncedChunkedArrayPolicy {
+    // Called after element moved to another place by compact/merge. `element` - is element at its new place.
+    // Called under chunk maintance lock. Do not access container from here.
+    template<class T, class Iterator>
+    static void on_relocate(T &/*element*/, const Iterator &/*from*/, const Iterator &/*to*/) {}
+
+    // Called right before element destruction (compact/merge/chunk destruction).
+    // Erased elements are destroyed lazily, so this may happen long after erase().
+    template<class T, class Iterator>
+    static void on_destroy(T &/*element*/, const Iterator &/*at*/) {}
+
+    // Time-to-live elements. Enables emplace_until/set_expiry/expire.
+    // Each chunk keeps expiry time per element + earliest expiry, so expire() visits only chunks with expired elements.
+    static constexpr const bool ttl = false;
+    using clock = std::chrono::steady_clock;
+
+    // Object recycling. Erased elements are not destructed, but reset with reset(), and kept for reuse
+    // by emplace_recycled(). compact() swap elements, instead of move+destroy.
+    // on_destroy called when element goes to recycle.
+    static constexpr const bool recycle = false;
+
+    template<class T>
+    static void reset(T &element) { element.reset(); }
+
+    // Keep memory of up to chunk_pool_capacity deleted chunks, for reuse. 0 - no pool.
+    // Pooled chunks memory can be returned to OS with trim(), keeping address space reserved.
+    static constexpr const std::size_t chunk_pool_capacity = 0;
+
+    // ~SyncedChunkedArray() does not block. Chunks (and elements) destroyed by background SyncedChunkedArrayReclaimer,
+    // after all iterations finish and all trackable_iterators unlock.
+    static constexpr const bool deferred_teardown = false;
+
+    // Non-relocating mode. Elements never move: erased elements destroyed in place, and their slots (holes)
+    // reused by emplace. No compact/merge - chunks freed only when empty. T may be non-movable, T* stays valid
+    // till erase. Costs some sparsity. Not compatible with recycle.
+    static constexpr const bool stable = false;
+
+    // Small containers. First chunk holds first_chunk_size elements, each next one 4x more, up to chunk_size.
+    // Outgrown small chunk merged into the next one (unless locked at that moment). 0 - all chunks full size.
+    static constexpr const std::size_t first_chunk_size = 0;
+
+    // Bounded lock hold time of iterate() (exclusive), for expensive closures. Every iterate_yield_elements elements,
+    // or iterate_yield_interval - if trackable_iterator::lock() waits for chunk, briefly release chunk lock to let it in.
+    // Chunk stays paused meanwhile: no maintenance, so iteration position stays valid. 0 - never.
+    static constexpr const std::size_t iterate_yield_elements = 0;
+    static constexpr const std::chrono::microseconds iterate_yield_interval{0};
+};
+
+/// One background thread per process, for deferred work (Policy::deferred_teardown).
+/// Jobs executed in FIFO order. Pending jobs finished at program exit.
+///
+/// Instance intentionally leaked - static containers destroyed after it still can defer(). It is drained
+/// and its thread joined from std::atexit; after that defer() runs job inline, in calling thread
+/// (so ~SyncedChunkedArray() of later destroyed static containers may block).
+class SyncedChunkedArrayReclaimer {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<std::function<void()>> jobs;
+    bool stop{false};
+
+    std::thread thread{[this]() { run(); }};
+
+    void run() {
+        std::vector<std::function<void()>> current;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> l(mutex);
+                cv.wait(l, [&]() { return stop || !jobs.empty(); });
+                if (jobs.empty()) return;      // stop
+
+                std::swap(current, jobs);
+            }
+
+            for (auto &job : current) job();
+            current.clear();
+        }
+    }
+
+    // finish pending jobs, join thread
+    void drain() {
+        {
+            std::unique_lock<std::mutex> l(mutex);
+            stop = true;
+        }
+        cv.notify_one();
+
+        // exit() called from job
+        if (thread.get_id() == std::this_thread::get_id()) {
+            thread.detach();
+        } else {
+            thread.join();
+        }
+    }
+
+    SyncedChunkedArrayReclaimer() {
+        std::atexit([]() { instance().drain(); });
+    }
+    ~SyncedChunkedArrayReclaimer() = delete;
+public:
+    static SyncedChunkedArrayReclaimer &instance() {
+        static SyncedChunkedArrayReclaimer &reclaimer = *new SyncedChunkedArrayReclaimer();
+        return reclaimer;
+    }
+
+    void defer(std::function<void()> job) {
+        bool stopped;
+        {
+            std::unique_lock<std::mutex> l(mutex);
+            stopped = stop;
+            if (!stopped) jobs.emplace_back(std::move(job));
+        }
+        if (stopped) {
+            job();      // drained at exit
+            return;
+        }
+        cv.notify_one();
+    }
+};
+
+/// Snapshot of container internals, see SyncedChunkedArray::metrics().
+/// Gauges are approximate (collected without chunk locks), counters - monotonic since construction.
+struct SyncedChunkedArrayMetrics {
+    // gauges
+    std::size_t elements{0};            // alive
+    std::size_t erased{0};              // erased, but not yet compacted
+    std::size_t chunks{0};
+    std::size_t capacity{0};            // element slots of all chunks
+    std::size_t free_list_chunks{0};    // not full chunks, available for emplace
+
+    double fill_ratio() const {
+        return capacity == 0 ? 0.0 : double(elements) / capacity;
+    }
+
+    // counters
+    std::size_t compactions{0};
+    std::size_t merges{0};
+    std::size_t chunks_released{0};     // deleted, or merged into other
+    std::size_t lock_contention{0};     // chunk try_lock failures (iterate skip, trackable_iterator lock retry)
+};
+
+/// Atomic access to plain field of element, see SyncedChunkedArray::iterate_relaxed().
+/// std::atomic_ref, where available. Otherwise minimal replacement on GCC/Clang builtins (integral and pointer fields).
+#if defined(__cpp_lib_atomic_ref)
+template<class U>
+using SyncedChunkedArrayAtomicRef = std::atomic_ref<U>;
+#elif defined(__GNUC__)
+template<class U>
+class SyncedChunkedArrayAtomicRef {
+    static_assert(std::is_integral<U>::value || std::is_pointer<U>::value, "integral or pointer field expected");
+    U *ptr;
+
+    static constexpr int order(std::memory_order order) {
+        switch (order) {
+            case std::memory_order_relaxed: return __ATOMIC_RELAXED;
+            case std::memory_order_consume: return __ATOMIC_CONSUME;
+            case std::memory_order_acquire: return __ATOMIC_ACQUIRE;
+            case std::memory_order_release: return __ATOMIC_RELEASE;
+            case std::memory_order_acq_rel: return __ATOMIC_ACQ_REL;
+            default:                        return __ATOMIC_SEQ_CST;
+        }
+    }
+
+    // failure order can't be release
+    static constexpr int failure_order(std::memory_order order) {
+        switch (order) {
+            case std::memory_order_release: return __ATOMIC_RELAXED;
+            case std::memory_order_acq_rel: return __ATOMIC_ACQUIRE;
+            default:                        return SyncedChunkedArrayAtomicRef::order(order);
+        }
+    }
+
+public:
+    using value_type = U;
+
+    explicit SyncedChunkedArrayAtomicRef(U &value)
+            : ptr(&value) {}
+
+    U load(std::memory_order m = std::memory_order_seq_cst) const { return __atomic_load_n(ptr, order(m)); }
+    void store(U value, std::memory_order m = std::memory_order_seq_cst) const { __atomic_store_n(ptr, value, order(m)); }
+    U exchange(U value, std::memory_order m = std::memory_order_seq_cst) const { return __atomic_exchange_n(ptr, value, order(m)); }
+
+    bool compare_exchange_weak(U &expected, U desired, std::memory_order m = std::memory_order_seq_cst) const {
+        return __atomic_compare_exchange_n(ptr, &expected, desired, true, order(m), failure_order(m));
+    }
+    bool compare_exchange_strong(U &expected, U desired, std::memory_order m = std::memory_order_seq_cst) const {
+        return __atomic_compare_exchange_n(ptr, &expected, desired, false, order(m), failure_order(m));
+    }
+
+    // integral only (builtins add bytes to pointers)
+    U fetch_add(U value, std::memory_order m = std::memory_order_seq_cst) const {
+        static_assert(std::is_integral<U>::value, "integral field expected");
+        return __atomic_fetch_add(ptr, value, order(m));
+    }
+    U fetch_sub(U value, std::memory_order m = std::memory_order_seq_cst) const {
+        static_assert(std::is_integral<U>::value, "integral field expected");
+        return __atomic_fetch_sub(ptr, value, order(m));
+    }
+    U fetch_and(U value, std::memory_order m = std::memory_order_seq_cst) const { return __atomic_fetch_and(ptr, value, order(m)); }
+    U fetch_or (U value, std::memory_order m = std::memory_order_seq_cst) const { return __atomic_fetch_or (ptr, value, order(m)); }
+
+    operator U() const { return load(); }
+};
+#endif
 
 template<class T, std::size_t chunk_size_t = std::max<std::size_t>(
         32,
         (std::size_t) (4096.0 / sizeof(T))    /* 4048 - best performance (higher has no effect) */
-)>
+), class Policy = SyncedChunkedArrayPolicy>
+class SyncedChunkedArray;
+
+template<class T, std::size_t chunk_size_t, class Policy>
+void swap(SyncedChunkedArray<T, chunk_size_t, Policy> &l, SyncedChunkedArray<T, chunk_size_t, Policy> &r) {
+    l.swap(r);
+}
+
+template<class T, std::size_t chunk_size_t, class Policy>
 class SyncedChunkedArray {
     struct settings {
         static constexpr const bool erase_immideatley = false;                   // false - for potentially higher speed
@@ -32,20 +268,149 @@ class SyncedChunkedArray {
         static constexpr const bool skip_locked_chunks_on_iteration = true;        // important. Must be true.
     };
 
-    using Self = SyncedChunkedArray<T, chunk_size_t>;
+    using Self = SyncedChunkedArray<T, chunk_size_t, Policy>;
+
+    static_assert(!(Policy::stable && Policy::recycle), "Policy::stable and Policy::recycle are mutually exclusive");
+
+    static constexpr const std::size_t first_chunk_capacity =
+            Policy::first_chunk_size == 0 ? chunk_size_t : std::min(Policy::first_chunk_size, chunk_size_t);
+
+    struct Chunk;
 
     struct SelfPtr {
-        using Lock = threading::SpinLock<threading::SpinLockMode::Nonstop>;
-        Lock lock;
+        static constexpr const std::size_t shards_count = 8;
 
-        Self *ptr;
+        static std::size_t shard_index() {
+            static thread_local const std::size_t shard = std::hash<std::thread::id>{}(std::this_thread::get_id()) % shards_count;
+            return shard;
+        }
+
+        // Back reference to container. Lock-free for readers (maintenance on access release):
+        // reader announce itself in its shard, then read ptr. Writer (swap/destructor) replace ptr, then wait
+        // till all shards drain. Either writer sees reader, or reader sees new ptr (seq_cst).
+        std::atomic<Self *> ptr;
+
+        struct alignas(64) ReadersShard {
+            std::atomic<std::size_t> readers{0};
+        };
+        ReadersShard readers_shards[shards_count];
+
+        // ptr value, while swap in progress. Readers wait - they must not skip free_list update.
+        static Self *busy() {
+            return reinterpret_cast<Self *>(alignof(Self));
+        }
+
+        // closure(Self*), if container alive
+        template<class Closure>
+        void with(Closure &&closure) {
+            std::atomic<std::size_t> &readers = readers_shards[shard_index()].readers;
+            while (true) {
+                readers.fetch_add(1);
+                Self *self = ptr.load();
+                if (self != busy()) {
+                    if (self) closure(self);
+                    readers.fetch_sub(1, std::memory_order_release);
+                    return;
+                }
+                readers.fetch_sub(1, std::memory_order_release);
+                std::this_thread::yield();
+            }
+        }
+
+        // Writers are not concurrent with each other
+        void store(Self *self) {
+            ptr.store(self);
+            for (ReadersShard &shard : readers_shards) {
+                while (shard.readers.load() != 0) std::this_thread::yield();
+            }
+        }
+
+        std::atomic<std::size_t> chunks_count{0};
+        std::atomic<std::size_t> chunks_bytes{0};       // Chunk::footprint() of all chunks, for budget
+
+        // Chunk::prev/next (and Chunk::unlinked) modified only under it - neighbours unlinked concurrently
+        // would otherwise relink each other. Readers just atomic_load.
+        using LinksLock = threading::SpinLock<threading::SpinLockMode::Nonstop>;
+        LinksLock links_lock;
+
+        // take_batch() start chunk per thread shard - last one taken from. Under links_lock.
+        // Cleared when chunk unlinked, so non-null one is linked, thus alive.
+        Chunk *take_hints[shards_count]{};
+
+        // under links_lock
+        void unlink(Chunk *chunk) {
+            chunk->unlinked = true;
+            for (Chunk *&hint : take_hints) {
+                if (hint == chunk) hint = nullptr;
+            }
+        }
+
+        // emplace_wait() waiters. budget_epoch changes (under budget_mutex) on any slot freeing, while there are
+        // waiters - whichever chunk it is (head chunk never goes to free list). Waiter registers before trying,
+        // notifier changes state before checking for waiters (seq_cst, both sides) - either waiter sees new state,
+        // or notifier sees waiter.
+        std::atomic<std::size_t> budget_waiters{0};
+        std::mutex budget_mutex;
+        std::condition_variable budget_cv;
+        std::size_t budget_epoch{0};
+
+        // chunk have free space now, chunk deleted, or budget raised
+        void notify_budget() {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (budget_waiters.load(std::memory_order_relaxed) == 0) return;
+
+            std::unique_lock<std::mutex> l(budget_mutex);
+            budget_epoch++;
+            budget_cv.notify_all();
+        }
+
+        // take_wait() waiters. take_epoch changes (under take_mutex) on emplace, while there are waiters.
+        // Same handshake as budget_waiters.
+        std::atomic<std::size_t> take_waiters{0};
+        std::mutex take_mutex;
+        std::condition_variable take_cv;
+        std::size_t take_epoch{0};
+
+        // element emplaced
+        void notify_takers() {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (take_waiters.load(std::memory_order_relaxed) == 0) return;
+
+            std::unique_lock<std::mutex> l(take_mutex);
+            take_epoch++;
+            take_cv.notify_one();
+        }
+
+        // Event counters, for metrics(). Sharded by thread - writers do not share cache line.
+        enum Event { compaction, merge, chunk_released, lock_contention, events_count };
+
+        struct alignas(64) Shard {
+            std::atomic<std::size_t> events[events_count]{};
+        };
+        Shard shards[shards_count];
+
+        void count(Event event) {
+            shards[shard_index()].events[event].fetch_add(1, std::memory_order_relaxed);
+        }
+
+        std::size_t get_count(Event event) const {
+            std::size_t sum = 0;
+            for (const Shard &shard : shards) sum += shard.events[event].load(std::memory_order_relaxed);
+            return sum;
+        }
 
         SelfPtr(Self *ptr)
                 : ptr(ptr) {}
     };
-
-    struct Chunk;
 public:
+    using value_type = T;
+    using clock = typename Policy::clock;
+    using time_point = typename clock::time_point;
+
+    // exclusive iterate() may release chunk lock mid-chunk (Policy::iterate_yield_*)
+    static constexpr const bool iterate_yields =
+            Policy::iterate_yield_elements > 0 || Policy::iterate_yield_interval.count() > 0;
+
     struct Iterator {
         Chunk *chunk;
         std::size_t index;
@@ -59,30 +424,99 @@ public:
         }
     };
 
+    // Element of pinned chunk (iterate_relaxed). Others may update it concurrently - only through atomic(field).
+    struct AtomicView {
+        Chunk *chunk;
+        std::size_t index;
+
+        const T &operator*() const {
+            return chunk->array()[index];
+        }
+
+        template<class U, class Element>       // Element - T or its base (T may be non-class)
+        SyncedChunkedArrayAtomicRef<U> atomic(U Element::*field) const {
+            return SyncedChunkedArrayAtomicRef<U>(chunk->array()[index].*field);
+        }
+    };
+
     class trackable_iterator;
 
+    // iterate() closure may take it as second parameter: closure(iter, context).
+    // emplace_deferred() stages elements; they emplaced in bulk after pass, thus not visited by it,
+    // and do not interfere with chunks locked by iterations.
+    class EmplaceContext {
+        friend Self;
+        std::vector<T> buffer;
+    public:
+        template<class ...Args>
+        void emplace_deferred(Args &&...args) {
+            buffer.emplace_back(std::forward<Args>(args)...);
+        }
+    };
+
 private:
+    // Flat combining (trackable_iterator::combine). Lives on caller stack, till state leaves pending.
+    struct CombineRequest {
+        enum State { pending, done, dead, moved };
+
+        const trackable_iterator *iter;
+        void *closure;
+        void (*run)(void *closure, T &element);
+
+        CombineRequest *next{nullptr};
+        std::atomic<State> state{pending};
+    };
+
     struct Chunk : std::enable_shared_from_this<Chunk> {
         Chunk(const Chunk&) = delete;
         Chunk(Chunk&&) = delete;
 
-        Chunk(std::shared_ptr<SelfPtr> self_ptr)
-                : self_ptr(self_ptr) {}
+        // storage - Chunk::storage_size(capacity) bytes, allocated together with chunk (see make_chunk)
+        Chunk(std::shared_ptr<SelfPtr> self_ptr, std::size_t capacity, char *storage)
+                : self_ptr(self_ptr)
+                , capacity(capacity) {
+            aliveness = place<std::atomic<bool>>(storage);
+            if constexpr (Policy::ttl) {
+                expiry.at = place<std::atomic<ExpiryRep>>(storage);
+            }
+            elements = reinterpret_cast<T *>(align(storage, alignof(T)));
+            storage = reinterpret_cast<char *>(elements + capacity);
+            trackables = place<Trackable>(storage);
+
+            this->self_ptr->chunks_count++;
+            this->self_ptr->chunks_bytes += footprint(capacity);
+        }
 
         ~Chunk(){
-            // destroy yet alive elements
+            // destroy yet alive, and erased but not compacted elements
             const std::size_t size = this->size;
             for (std::size_t i = 0; i < size; i++) {
-                if (!aliveness[i].load()) continue;
-                track_delete_element(this, i);
+                if (holes.has(i)) continue;
+                destroy_element(this, i, false);
+            }
+
+            // destroy recycled
+            for (std::size_t i = size; i < constructed_size; i++) {
                 array()[i].~T();
             }
+
+            for (std::size_t i = 0; i < capacity; i++) {
+                trackables[i].~Trackable();
+            }
+
+            self_ptr->chunks_count--;
+            self_ptr->chunks_bytes -= footprint(capacity);
+            self_ptr->notify_budget();
         }
 
-        // atomic_shared_ptr. Updated only under maintance lock
+        // atomic_shared_ptr. Updated only under self_ptr->links_lock
         std::shared_ptr<Chunk> next{nullptr};
         std::shared_ptr<Chunk> prev{nullptr};           // weak_ptr have no atomic operations, so use shared_ptr and manually set to nullptr (at maintance.merge)
 
+        // Removed from chunks list (next kept, for iterations standing on it). Never linked, nor get elements again.
+        // Set under links_lock + unique lock + maintance lock.
+        bool unlinked{false};
+
         // Ownership lock
         using Lock = threading::RecursiveLevelCounter<
                 threading::Recursive<threading::RWSpinLockWriterBiased<threading::SpinLockMode::Nonstop>>
@@ -107,26 +541,97 @@ private:
 
         std::atomic<bool> is_first{false};     // for check only (updates in emplace)
 
+        // published, not yet executed CombineRequests (lock-free stack)
+        std::atomic<CombineRequest *> combine_requests{nullptr};
+
+        // Policy::iterate_yield_*. trackable_iterator::lock() waiting for chunk lock; iterations, which released
+        // lock mid chunk (no maintenance while > 0).
+        std::atomic<unsigned> lock_waiters{0};
+        std::atomic<unsigned> paused{0};
+
 
         std::atomic<std::size_t> size{0};
         std::atomic<std::size_t> deleted_count{0};
 
+        // Policy::recycle only. [size, constructed_size) - recycled elements. Under maintance lock.
+        std::size_t constructed_size{0};
+
+        // Policy::stable only. Slots in [0, size) with destroyed elements, ready for reuse. Modified under maintance lock.
+        struct Holes {
+            static constexpr const std::size_t bits = 64;
+            std::uint64_t bitmap[(chunk_size_t + bits - 1) / bits]{};
+            std::atomic<std::size_t> count{0};
+
+            bool has(std::size_t index) const {
+                return bitmap[index / bits] & (std::uint64_t(1) << (index % bits));
+            }
+
+            void add(std::size_t index) {
+                bitmap[index / bits] |= std::uint64_t(1) << (index % bits);
+                count++;
+            }
+
+            void remove(std::size_t index) {
+                bitmap[index / bits] &= ~(std::uint64_t(1) << (index % bits));
+                count--;
+            }
+
+            // lowest hole. count must be > 0
+            std::size_t take() {
+                for (std::size_t w = 0;; w++) {
+                    if (!bitmap[w]) continue;
+                    std::size_t bit = 0;
+                    while (!(bitmap[w] & (std::uint64_t(1) << bit))) bit++;
+
+                    const std::size_t index = w * bits + bit;
+                    remove(index);
+                    return index;
+                }
+            }
+        };
+        struct NoHoles {
+            static constexpr const std::size_t count = 0;
+            bool has(std::size_t) const { return false; }
+        };
+        std::conditional_t<Policy::stable, Holes, NoHoles> holes;
+
         std::size_t alive_size() const {
-            return size - deleted_count;
+            return size - deleted_count - holes.count;
         }
 
+        // chunk_size_t, or less for small first chunks (Policy::first_chunk_size)
+        const std::size_t capacity;
+
         bool is_full() const {
-            return size == chunk_size_t;
+            return size == capacity && holes.count == 0;
+        }
+
+        std::size_t merge_threshold() const {
+            return capacity * 0.25;      // for pathological cases only
         }
 
-        constexpr const static std::size_t merge_threshold = chunk_size_t * 0.25;      // for pathological cases only
+        // Per element arrays live in storage right after chunk, sized by capacity.
+        std::atomic<bool> *aliveness;    // keep separate from values (faster skip)
+
+        // time_point::rep, to be lock-free
+        using ExpiryRep = typename time_point::rep;
+        struct Expiry {
+            // earliest expiry of chunk elements. May be earlier then actual (updated lazily on erase/compact).
+            std::atomic<ExpiryRep> earliest{std::numeric_limits<ExpiryRep>::max()};
+            std::atomic<ExpiryRep> *at{nullptr};
 
-        std::atomic<bool> aliveness[chunk_size_t];    // keep separate from values (faster skip)
+            void update_earliest(ExpiryRep expiry) {
+                ExpiryRep current = earliest.load();
+                while (expiry < current && !earliest.compare_exchange_weak(current, expiry));
+            }
+        };
+        struct NoExpiry {};
+        std::conditional_t<Policy::ttl, Expiry, NoExpiry> expiry;     // keep separate from values too
 
-        char/*std::byte*/ memory[chunk_size_t * sizeof(T)];
+        T *elements;
 
         T *array() {
-            return reinterpret_cast<T *>(memory);
+            return elements;
         }
 
 
@@ -140,11 +645,39 @@ private:
 
             trackable_iterator *first{nullptr};
         };
-        Trackable trackables[chunk_size_t];
+        Trackable *trackables;
+
+        static char *align(char *ptr, std::size_t alignment) {
+            const std::uintptr_t address = reinterpret_cast<std::uintptr_t>(ptr);
+            return ptr + (alignment - address % alignment) % alignment;
+        }
+
+        // construct capacity objects at storage, advance storage past them
+        template<class U>
+        U *place(char *&storage) {
+            U *items = reinterpret_cast<U *>(align(storage, alignof(U)));
+            for (std::size_t i = 0; i < capacity; i++) new(&items[i]) U();
+            storage = reinterpret_cast<char *>(items + capacity);
+            return items;
+        }
+
+        // chunk memory, as counted by budget
+        static constexpr std::size_t footprint(std::size_t capacity) {
+            return sizeof(Chunk) + storage_size(capacity);
+        }
+
+        // bytes for per element arrays, with alignment slack
+        static constexpr std::size_t storage_size(std::size_t capacity) {
+            std::size_t size = capacity * (sizeof(std::atomic<bool>) + sizeof(T) + sizeof(Trackable))
+                               + alignof(T) + alignof(Trackable);
+            if constexpr (Policy::ttl) size += capacity * sizeof(std::atomic<ExpiryRep>) + alignof(std::atomic<ExpiryRep>);
+            return size;
+        }
 
         bool is_alive_fast_check(std::size_t index) const{
             // #https://stackoverflow.com/questions/46680842/c-stdmemory-order-relaxed-and-skip-stop-flag
-            return aliveness[index].load(settings::erase_immideatley ? std::memory_order_acquire : std::memory_order_relaxed);
+            // Policy::stable - element may be just emplaced into hole, concurrently
+            return aliveness[index].load(settings::erase_immideatley || Policy::stable ? std::memory_order_acquire : std::memory_order_relaxed);
         }
 
         template<class Closure>
@@ -158,10 +691,27 @@ private:
 
         template<class ...Args>
         std::size_t emplace(Args &&...args) {
+            if constexpr (Policy::stable) {
+                if (holes.count > 0) {
+                    const std::size_t index = holes.take();
+                    new(&array()[index]) T(std::forward<Args>(args)...);
+                    aliveness[index].store(true, std::memory_order_release);
+                    return index;
+                }
+            }
+
             const std::size_t index = this->size;
 
             T &ptr = array()[index];
 
+            if constexpr (Policy::recycle) {
+                if (index < constructed_size) {
+                    ptr.~T();
+                } else {
+                    constructed_size = index + 1;
+                }
+            }
+
             new(&ptr) T(std::forward<Args>(args)...);
             aliveness[index].store(true, std::memory_order_release);
 
@@ -170,12 +720,60 @@ private:
             return index;
         }
 
+        template<class Init>
+        std::size_t emplace_recycled(Init &&init) {
+            const std::size_t index = this->size;
+
+            T &element = array()[index];
+            if (index >= constructed_size) {
+                new(&element) T();
+                constructed_size = index + 1;
+            }
+
+            init(element);
+            aliveness[index].store(true, std::memory_order_release);
+
+            size++;
+
+            return index;
+        }
+
         void erase(std::size_t index) {
-            assert(index < chunk_size_t);
+            assert(index < capacity);
 
             aliveness[index].store(false, std::memory_order_release);
             deleted_count++;
         }
+
+        // under chunk lock, or maintance lock for just emplaced
+        void set_expiry(std::size_t index, time_point time) {
+            const ExpiryRep rep = time.time_since_epoch().count();
+            expiry.at[index].store(rep);
+            expiry.update_earliest(rep);
+        }
+
+        // under unique lock + maintance lock
+        std::size_t expire(time_point now) {
+            const ExpiryRep now_rep = now.time_since_epoch().count();
+            ExpiryRep earliest = std::numeric_limits<ExpiryRep>::max();
+            std::size_t expired = 0;
+
+            const std::size_t size = this->size;
+            for (std::size_t i = 0; i < size; i++) {
+                if (!aliveness[i]) continue;
+
+                const ExpiryRep at = expiry.at[i].load(std::memory_order_relaxed);
+                if (at <= now_rep) {
+                    erase(i);
+                    expired++;
+                } else if (at < earliest) {
+                    earliest = at;
+                }
+            }
+
+            expiry.earliest = earliest;
+            return expired;
+        }
     };
 
     using FirstLock = threading::SpinLock<threading::SpinLockMode::Nonstop>;
@@ -187,27 +785,54 @@ private:
         using FreeListLock = threading::SpinLock<threading::SpinLockMode::Nonstop>;
         FreeListLock lock;
         std::atomic<bool> is_empty{true};        // true if free_list_first == nullptr
+        std::atomic<std::size_t> count{0};       // for metrics only
         Chunk *first{nullptr};
     public:
         FreeList() {}
 
-        FreeList(FreeList &&other) {
-            std::unique_lock<FreeListLock> l(other.lock);
-            first = other.first;
-            is_empty = other.is_empty.load();
+        bool empty() const {
+            return is_empty;
         }
 
-        Chunk *get_first_under_maintance_lock(std::unique_lock<typename Chunk::MaintanceLock> &l_maintance) {
-            if (is_empty) return nullptr;
+        std::size_t size() const {
+            return count.load(std::memory_order_relaxed);
+        }
 
-            auto locks = threading::lock_functional(
-                [&](){ return &lock; },
-                [&](){ return &first->maintance_lock; }
-            );
+        FreeList(const FreeList &) = delete;
+
+        void swap(FreeList &other) {
+            std::unique_lock<FreeListLock> l{lock, std::defer_lock};
+            std::unique_lock<FreeListLock> l_other{other.lock, std::defer_lock};
+            std::lock(l, l_other);
 
-            l_maintance = std::move(std::get<1>(locks));
+            std::swap(first, other.first);
 
-            return first;
+            const std::size_t was_count = count;
+            count = other.count.load();
+            other.count = was_count;
+
+            const bool was_empty = is_empty;
+            is_empty = other.is_empty.load();
+            other.is_empty = was_empty;
+        }
+
+        // Lock order is maintance_lock -> free list lock (see add/erase). So here maintance_lock only try-locked,
+        // with back off. first may become nullptr, while we wait for lock.
+        Chunk *get_first_under_maintance_lock(std::unique_lock<typename Chunk::MaintanceLock> &l_maintance) {
+            while (true) {
+                if (is_empty) return nullptr;
+                {
+                    std::unique_lock<FreeListLock> l(lock);
+                    if (!first) return nullptr;
+
+                    std::unique_lock<typename Chunk::MaintanceLock> l_m(first->maintance_lock, std::try_to_lock);
+                    if (l_m) {
+                        l_maintance = std::move(l_m);
+                        return first;
+                    }
+                }
+                std::this_thread::yield();
+            }
         }
 
         void erase(Chunk *chunk, std::unique_lock<typename Chunk::MaintanceLock> &chunk_maintance_lock) {
@@ -227,7 +852,10 @@ private:
                 if (first) first->prev_free = nullptr;
             }
             if (!first) is_empty = true;
+            chunk->next_free = nullptr;     // stale links would relink neighbours on next erase
+            chunk->prev_free = nullptr;
             chunk->in_free_list = false;
+            count.fetch_sub(1, std::memory_order_relaxed);
         }
 
         void add(Chunk *chunk, std::unique_lock<typename Chunk::MaintanceLock> &chunk_maintance_lock) {
@@ -237,12 +865,14 @@ private:
 
             std::unique_lock<FreeListLock> l(lock);    // it's ok, we have fixed lock order
 
+            chunk->prev_free = nullptr;
             chunk->next_free = first;
             if (first) first->prev_free = chunk;
             first = chunk;
 
             if (is_empty) is_empty = false;
             chunk->in_free_list = true;
+            count.fetch_add(1, std::memory_order_relaxed);
         }
     } free_list;
 
@@ -250,6 +880,144 @@ private:
     // used only by ~trackable_iterator to maintain (maintain may add to free_list)
     std::shared_ptr<SelfPtr> self_ptr{std::make_shared<SelfPtr>(this)};
 
+
+    // Memory blocks of deleted chunks. Outlive container, till last chunk destroyed (held by ChunkAllocator).
+    class ChunkPool {
+        using Lock = threading::SpinLock<threading::SpinLockMode::Yield>;
+        Lock lock;
+
+        struct Block {
+            void *ptr;
+            time_point released;
+            bool trimmed;
+        };
+        std::vector<Block> blocks;       // LIFO - most recently released (hot) at back
+        std::size_t block_size{0};       // all chunks have the same size
+
+        static void *allocate_block(std::size_t size) {
+        #ifdef SYNCED_CHUNKED_ARRAY_MADVISE
+            void *ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (ptr == MAP_FAILED) throw std::bad_alloc();
+            return ptr;
+        #else
+            return ::operator new(size);
+        #endif
+        }
+
+        static void free_block(void *ptr, std::size_t size) {
+        #ifdef SYNCED_CHUNKED_ARRAY_MADVISE
+            munmap(ptr, size);
+        #else
+            ::operator delete(ptr);
+        #endif
+        }
+
+    public:
+        ChunkPool() {}
+        ChunkPool(const ChunkPool &) = delete;
+
+        ~ChunkPool() {
+            for (Block &block : blocks) free_block(block.ptr, block_size);
+        }
+
+        void *allocate(std::size_t size) {
+            {
+                std::unique_lock<Lock> l(lock);
+                if (size == block_size && !blocks.empty()) {
+                    void *ptr = blocks.back().ptr;
+                    blocks.pop_back();
+                    return ptr;
+                }
+            }
+            return allocate_block(size);
+        }
+
+        void deallocate(void *ptr, std::size_t size) {
+            {
+                std::unique_lock<Lock> l(lock);
+                if (block_size == 0) block_size = size;
+                if (size == block_size && blocks.size() < Policy::chunk_pool_capacity) {
+                    blocks.push_back({ptr, clock::now(), false});
+                    return;
+                }
+            }
+            free_block(ptr, size);
+        }
+
+        // return memory of blocks, released more than `idle` ago, to OS. Return trimmed blocks count.
+        std::size_t trim(typename clock::duration idle) {
+            std::size_t trimmed = 0;
+        #ifdef SYNCED_CHUNKED_ARRAY_MADVISE
+            const time_point now = clock::now();
+
+            // under lock - block must not be reused while madvise
+            std::unique_lock<Lock> l(lock);
+            for (Block &block : blocks) {
+                if (block.trimmed || now - block.released < idle) continue;
+
+                madvise(block.ptr, block_size, MADV_DONTNEED);     // MADV_FREE does not drop RSS, till memory pressure
+                block.trimmed = true;
+                trimmed++;
+            }
+        #endif
+            return trimmed;
+        }
+
+        std::size_t size() {
+            std::unique_lock<Lock> l(lock);
+            return blocks.size();
+        }
+    };
+
+    // Chunk is followed by its per element storage, in the same allocation. Full size chunks come from pool (if any).
+    template<class U>
+    struct ChunkAllocator {
+        using value_type = U;
+
+        std::shared_ptr<ChunkPool> pool;
+        std::size_t storage_size;
+        char **storage;                 // receives storage address, on allocate
+
+        ChunkAllocator(std::shared_ptr<ChunkPool> pool, std::size_t storage_size, char **storage)
+                : pool(std::move(pool)), storage_size(storage_size), storage(storage) {}
+
+        template<class V>
+        ChunkAllocator(const ChunkAllocator<V> &other)
+                : pool(other.pool), storage_size(other.storage_size), storage(other.storage) {}
+
+        U *allocate(std::size_t n) {
+            const std::size_t size = n * sizeof(U) + storage_size;
+            char *ptr = static_cast<char *>(pool ? pool->allocate(size) : ::operator new(size));
+            *storage = ptr + n * sizeof(U);
+            return reinterpret_cast<U *>(ptr);
+        }
+
+        void deallocate(U *ptr, std::size_t n) {
+            const std::size_t size = n * sizeof(U) + storage_size;
+            if (pool) {
+                pool->deallocate(ptr, size);
+            } else {
+                ::operator delete(ptr);
+            }
+        }
+
+        template<class V>
+        bool operator==(const ChunkAllocator<V> &other) const { return pool == other.pool && storage_size == other.storage_size; }
+
+        template<class V>
+        bool operator!=(const ChunkAllocator<V> &other) const { return !(*this == other); }
+    };
+
+    std::shared_ptr<ChunkPool> chunk_pool{Policy::chunk_pool_capacity > 0 ? std::make_shared<ChunkPool>() : nullptr};
+
+    std::shared_ptr<Chunk> make_chunk(std::size_t capacity = chunk_size_t) {
+        // allocate_shared allocates, then constructs - storage is set by then
+        char *storage = nullptr;
+        return std::allocate_shared<Chunk>(
+                ChunkAllocator<Chunk>(capacity == chunk_size_t ? chunk_pool : nullptr, Chunk::storage_size(capacity), &storage),
+                self_ptr, capacity, std::ref(storage));
+    }
+
     template<class Closure>
     static void iterate_trackable_iterators(trackable_iterator *iter, Closure &&closure) {
         while (iter) {
@@ -266,7 +1034,8 @@ private:
 
         std::unique_lock<typename Chunk::Trackable::Lock> l(trackable.lock);
 
-        iterate_trackable_iterators(trackable.first, [](trackable_iterator *iter) {
+        iterate_trackable_iterators(trackable.first, [&](trackable_iterator *iter) {
+            iter->stop_waiting(chunk);
             iter->chunk = nullptr;
         });
 
@@ -290,11 +1059,14 @@ private:
         std::unique_lock<typename Chunk::Trackable::Lock> lock_to{trackable_to.lock, std::defer_lock};
         std::lock(lock_from, lock_to);
 
-        iterate_trackable_iterators(trackable_to.first, [](trackable_iterator *iter) {
+        iterate_trackable_iterators(trackable_to.first, [&](trackable_iterator *iter) {
+            iter->stop_waiting(chunk_to);
             iter->chunk = nullptr;
         });
 
         iterate_trackable_iterators(trackable_from.first, [&](trackable_iterator *iter) {
+            // waiting lock() follows element
+            if (iter->stop_waiting(chunk_from)) iter->start_waiting(chunk_to);
             iter->chunk = chunk_to;
             iter->index = index_to;
         });
@@ -311,8 +1083,53 @@ private:
         track_move_element(chunk, index_from, chunk, index_to);
     }
 
+    // with recycle, element stays constructed (in reset state)
+    static void destroy_element(Chunk *chunk, std::size_t index, bool recycle = Policy::recycle) {
+        track_delete_element(chunk, index);
+
+        T &element = chunk->array()[index];
+        Policy::on_destroy(element, Iterator{chunk, index});
+
+        if constexpr (Policy::recycle) {
+            if (recycle) {
+                Policy::reset(element);
+                return;
+            }
+        }
+        element.~T();
+    }
+
+    // move element to not constructed (or recycled) place
+    static void relocate_element(Chunk *chunk_from, std::size_t index_from, Chunk *chunk_to, std::size_t index_to) {
+        track_move_element(chunk_from, index_from, chunk_to, index_to);
+
+        T &element_from = chunk_from->array()[index_from];
+        T &element_to   = chunk_to->array()[index_to];
+        if constexpr (Policy::recycle) {
+            // element_from become recycled
+            if (index_to < chunk_to->constructed_size) {
+                using std::swap;
+                swap(element_to, element_from);
+            } else {
+                new(&element_to) T(std::move(element_from));
+                Policy::reset(element_from);
+                chunk_to->constructed_size = index_to + 1;
+            }
+        } else {
+            new(&element_to) T(std::move(element_from));
+            element_from.~T();
+        }
+
+        if constexpr (Policy::ttl) {
+            chunk_to->expiry.at[index_to].store(chunk_from->expiry.at[index_from].load());
+        }
+
+        Policy::on_relocate(element_to, Iterator{chunk_from, index_from}, Iterator{chunk_to, index_to});
+    }
+
     static void compact(Chunk *chunk, std::unique_lock<typename Chunk::MaintanceLock> &maintance_lock) {
         assert(maintance_lock.owns_lock());
+        chunk->self_ptr->count(SelfPtr::compaction);
 
         std::size_t deleted_left = chunk->deleted_count;
         std::size_t m_chunk_size = chunk->size;
@@ -322,9 +1139,8 @@ private:
 
             // clear head first
             while (chunk->aliveness[m_chunk_size - 1] == false) {
-                track_delete_element(chunk, m_chunk_size - 1);
+                destroy_element(chunk, m_chunk_size - 1);
 
-                chunk->array()[m_chunk_size - 1].~T();
                 chunk->aliveness[m_chunk_size - 1] = false;
                 deleted_left--;
                 m_chunk_size--;
@@ -333,14 +1149,10 @@ private:
             }
             if (i >= m_chunk_size) break;
 
-            track_move_element(chunk, m_chunk_size - 1, i);
-
-            T &element = chunk->array()[i];
-            T &element_last = chunk->array()[m_chunk_size - 1];
-            element = std::move(element_last);
+            destroy_element(chunk, i);
+            relocate_element(chunk, m_chunk_size - 1, chunk, i);
             alivness = true;
 
-            element_last.~T();
             chunk->aliveness[m_chunk_size - 1] = false;
             m_chunk_size--;
 
@@ -353,12 +1165,37 @@ private:
         chunk->size = m_chunk_size;
     }
 
+    // Policy::stable. Destroy erased elements in place, their slots become holes. Trailing holes just cut off.
+    static void reclaim(Chunk *chunk, std::unique_lock<typename Chunk::MaintanceLock> &maintance_lock) {
+        assert(maintance_lock.owns_lock());
+        chunk->self_ptr->count(SelfPtr::compaction);
+
+        std::size_t deleted_left = chunk->deleted_count;
+        std::size_t m_chunk_size = chunk->size;
+        for (std::size_t i = 0; i < m_chunk_size && deleted_left > 0; i++) {
+            if (chunk->aliveness[i] || chunk->holes.has(i)) continue;
+
+            destroy_element(chunk, i);
+            chunk->holes.add(i);
+            deleted_left--;
+        }
+
+        while (m_chunk_size > 0 && chunk->holes.has(m_chunk_size - 1)) {
+            chunk->holes.remove(m_chunk_size - 1);
+            m_chunk_size--;
+        }
+
+        chunk->deleted_count = 0;
+        chunk->size = m_chunk_size;
+    }
+
     static void merge(Chunk *chunk_to, Chunk *chunk_from,
           std::unique_lock<typename Chunk::MaintanceLock> &maintance_lock_to,
           std::unique_lock<typename Chunk::MaintanceLock> &maintance_lock_from
     ) {
         assert(maintance_lock_to.owns_lock());
         assert(maintance_lock_from.owns_lock());
+        chunk_to->self_ptr->count(SelfPtr::merge);
 
         if (chunk_to->deleted_count > 0) {
             compact(chunk_to, maintance_lock_to);
@@ -366,30 +1203,92 @@ private:
 
         const std::size_t m_chunk_size = chunk_from->size;
         for (std::size_t i = 0; i < m_chunk_size; i++) {
-            if (!chunk_from->aliveness[i]) continue;
+            if (!chunk_from->aliveness[i]) {
+                destroy_element(chunk_from, i);
+                continue;
+            }
 
             const std::size_t index_to = chunk_to->size;
 
-            track_move_element(chunk_from, i, chunk_to, index_to);
-
-            chunk_to->array()[index_to] = std::move(chunk_from->array()[i]);
+            relocate_element(chunk_from, i, chunk_to, index_to);
             chunk_to->aliveness[index_to] = true;
             chunk_to->size++;
 
-            chunk_from->array()[i].~T();
+            chunk_from->aliveness[i] = false;
+        }
+
+        if constexpr (Policy::ttl) {
+            chunk_to->expiry.update_earliest(chunk_from->expiry.earliest);
         }
 
         chunk_from->size = 0;
         chunk_from->deleted_count = 0;
     }
 
+    static typename CombineRequest::State execute(Chunk *chunk, CombineRequest *request) {
+        std::size_t index;
+        {
+            std::unique_lock<typename trackable_iterator::Lock> l(request->iter->m_lock);
+            if (request->iter->chunk != chunk) {
+                return request->iter->chunk ? CombineRequest::moved : CombineRequest::dead;
+            }
+            index = request->iter->index;
+        }
+        if (!chunk->aliveness[index]) return CombineRequest::dead;
+
+        request->run(request->closure, chunk->array()[index]);
+        return CombineRequest::done;
+    }
+
+    // under chunk unique lock, right before unlock. Any unique lock holder executes published requests, so waiters
+    // get completion without acquiring lock. Requests published after that - executed by their owners (or next holder).
+    static void execute_combine_requests(Chunk *chunk) {
+        if (!chunk->combine_requests.load(std::memory_order_relaxed)) return;
+
+        for (int pass = 0; pass < 2; pass++) {
+            CombineRequest *request = chunk->combine_requests.exchange(nullptr, std::memory_order_acquire);
+            if (!request) break;
+
+            while (request) {
+                CombineRequest *next = request->next;      // request may be gone, as soon as state set
+                request->state.store(execute(chunk, request), std::memory_order_release);
+                request = next;
+            }
+        }
+    }
+
+    // Move elements of outgrown small first chunk to new (not yet linked) first chunk, and put new one in its place.
+    // Unlinked chunk keeps next, for iterations standing on it. Return false, if chunk in use.
+    static bool absorb(Chunk *chunk_to, Chunk *chunk_from, std::unique_lock<typename Chunk::MaintanceLock> &maintance_lock_from) {
+        if constexpr (Policy::stable) {
+            return false;       // elements must not move
+        } else {
+            std::unique_lock<typename Chunk::Lock> l(chunk_from->lock, std::try_to_lock);
+            if (!l || chunk_from->lock.level() != 1 || chunk_from->paused.load(std::memory_order_relaxed)) return false;
+
+            std::unique_lock<typename Chunk::MaintanceLock> maintance_lock_to(chunk_to->maintance_lock);
+            merge(chunk_to, chunk_from, maintance_lock_to, maintance_lock_from);
+            chunk_from->self_ptr->count(SelfPtr::chunk_released);
+
+            std::unique_lock<typename SelfPtr::LinksLock> l_links(chunk_from->self_ptr->links_lock);
+            std::shared_ptr<Chunk> next = std::atomic_load(&chunk_from->next);
+            std::atomic_store(&chunk_to->next, next);
+            if (next) std::atomic_store(&next->prev, chunk_to->shared_from_this());
+
+            const std::shared_ptr<Chunk> chunk_null{nullptr};
+            std::atomic_store(&chunk_from->prev, chunk_null);
+            chunk_from->self_ptr->unlink(chunk_from);
+            return true;
+        }
+    }
+
     // chunk may become destructed if not holded by shared_ptr above
     template<bool shared>
     static void maintain_and_unlock(Chunk *chunk, Self *p_self = nullptr) {
         // !shared chunk must come under unique_lock
         // shared under shared_lock
 
-        const bool need_merge  = !chunk->is_first && chunk->alive_size() <= Chunk::merge_threshold;
+        const bool need_merge  = !Policy::stable && !chunk->is_first && chunk->alive_size() <= chunk->merge_threshold();
         const bool need_compact = chunk->deleted_count > 0;
         const bool need_maintain = need_merge || need_compact;
 
@@ -399,18 +1298,16 @@ private:
         // chunk must be under unique_lock + maintance lock to be deleted
         auto remove_chunk = [&](Chunk *chunk) {
             chunk_self = chunk->shared_from_this();      assert(chunk_self);
-            std::shared_ptr<Chunk> prev = std::atomic_load(&chunk->prev);
-            std::shared_ptr<Chunk> next = std::atomic_load(&chunk->next);
 
-            if (prev){
-                std::shared_ptr<Chunk> self = chunk_self;
-                std::atomic_compare_exchange_strong(&prev->next, &self, next);
-            }
+            std::unique_lock<typename SelfPtr::LinksLock> l_links(chunk->self_ptr->links_lock);
+            if (chunk->unlinked) return;        // absorbed small chunk, or torn down
+            chunk->self_ptr->unlink(chunk);
+            chunk->self_ptr->count(SelfPtr::chunk_released);
 
-            if (next){
-                std::shared_ptr<Chunk> self = chunk_self;
-                std::atomic_compare_exchange_strong(&next->prev, &self, prev);
-            }
+            std::shared_ptr<Chunk> prev = std::atomic_load(&chunk->prev);
+            std::shared_ptr<Chunk> next = std::atomic_load(&chunk->next);
+            if (prev) std::atomic_store(&prev->next, next);
+            if (next) std::atomic_store(&next->prev, prev);
 
             // unlink prev
             const std::shared_ptr<Chunk> chunk_null{nullptr};
@@ -418,19 +1315,15 @@ private:
         };
 
         auto can_merge = [](Chunk *chunk, Chunk *other) -> bool {
-            return !chunk->is_first && !other->is_first
-                   && (chunk->alive_size() + other->alive_size()) <= Chunk::merge_threshold;
+            return !Policy::stable && !chunk->is_first && !other->is_first
+                   && (chunk->alive_size() + other->alive_size()) <= std::min(chunk->merge_threshold(), other->merge_threshold());
         };
 
         auto if_self = [](Self *p_self, Chunk *chunk, auto &&closure) {
-            std::unique_lock<typename SelfPtr::Lock> self_ptr_lock;
-            Self *self = p_self;
-            if (!self) {
-                self_ptr_lock = std::unique_lock<typename SelfPtr::Lock>(chunk->self_ptr->lock);
-                self = chunk->self_ptr->ptr;
-            }
-            if (self) {
-                closure(self);
+            if (p_self) {
+                closure(p_self);
+            } else {
+                chunk->self_ptr->with(closure);
             }
         };
 
@@ -438,6 +1331,7 @@ private:
                                               std::unique_lock<typename Chunk::MaintanceLock> &l_m) {
             if (!chunk->in_free_list && !chunk->is_full()
                 && !chunk->is_first     /* may delete this check */
+                && !chunk->unlinked
                     ) {
                 if_self(p_self, chunk, [&](Self *self) {
                     self->free_list.add(chunk, l_m);
@@ -459,12 +1353,14 @@ private:
 
             std::unique_lock<typename Chunk::Lock> l(other->lock, std::try_to_lock);
             if (!l) return false;
+            if (other->paused.load(std::memory_order_relaxed)) return false;
 
             std::unique_lock<typename Chunk::MaintanceLock> l_m_chunk{chunk->maintance_lock, std::defer_lock};
             std::unique_lock<typename Chunk::MaintanceLock> l_m_other{other->maintance_lock, std::defer_lock};
             std::lock(l_m_chunk, l_m_other);
 
-            if (!can_merge(chunk, other)) return false;
+            // other may be unlinked since we read it - merging into it would lose elements
+            if (chunk->unlinked || other->unlinked || !can_merge(chunk, other)) return false;
 
             {
                 Chunk *from;
@@ -481,7 +1377,10 @@ private:
                     from = chunk;       from_maintance_lock = &l_m_chunk;
                 }
 
-                merge(to, from, *to_maintance_lock, *from_maintance_lock);
+                // not instantiated for Policy::stable - T may be non-movable
+                if constexpr (!Policy::stable) {
+                    merge(to, from, *to_maintance_lock, *from_maintance_lock);
+                }
 
                 // remove "from chunk" free_list
                 try_remove_from_free_list(p_self, from, *from_maintance_lock);
@@ -510,6 +1409,7 @@ private:
 
         auto try_maintain = [&]() {
             if (chunk->lock.level() != 1) return;    // maintain only at toppest level
+            if (chunk->paused.load(std::memory_order_relaxed)) return;      // iteration stands in the middle
 
             if (try_delete(chunk)) return;
 
@@ -526,14 +1426,21 @@ private:
             // still need compact?
             if (chunk->deleted_count > 0) {
                 std::unique_lock<typename Chunk::MaintanceLock> l_m{chunk->maintance_lock};
-                compact(chunk, l_m);
+                if constexpr (Policy::stable) {
+                    reclaim(chunk, l_m);
+                } else {
+                    compact(chunk, l_m);
+                }
                 try_add_to_free_list(p_self, chunk, l_m);
             }
+
+            chunk->self_ptr->notify_budget();
         };
 
         // maintance
         if (!shared) {
             // we under unique_lock now
+            execute_combine_requests(chunk);
             if (need_maintain) try_maintain();
             chunk->lock.unlock();
         } else {
@@ -553,115 +1460,494 @@ public:
 
     // TODO: add copy
 
-    // maybe better to put SyncedChunkedArray in shared_ptr ?
-    // or make SyncedChunkedArray non movable?
-    SyncedChunkedArray(SyncedChunkedArray &&other) {
-        std::unique_lock l_other_self_ptr(other.self_ptr->lock);
+    // Thread-safe with trackable_iterators usage. Not with other operations on `other`.
+    SyncedChunkedArray(SyncedChunkedArray &&other)
+            : SyncedChunkedArray() {
+        swap(other);
+    }
 
-        {
-            std::unique_lock l_other(other.first_lock);
-            first = std::move(other.first);
-        }
+    // Same as move ctor. Previous elements destroyed as in ~SyncedChunkedArray().
+    SyncedChunkedArray &operator=(SyncedChunkedArray &&other) {
+        if (this == &other) return *this;
+
+        SyncedChunkedArray previous(std::move(other));
+        swap(previous);
+        return *this;
+    }
+
+    // O(1). Chunks stay in place, with their trackable_iterators - only owners exchanged.
+    // Thread-safe with trackable_iterators usage (access release may do maintance, which update owner's free_list),
+    // not with other operations on these containers.
+    void swap(SyncedChunkedArray &other) {
+        if (this == &other) return;
+
+        // hold off access release maintenance (it may update free_list)
+        self_ptr->store(SelfPtr::busy());
+        other.self_ptr->store(SelfPtr::busy());
 
-        free_list = std::move(other.free_list);
+        // fixed lock order: first -> free_list
+        std::unique_lock<FirstLock> l_first{first_lock, std::defer_lock};
+        std::unique_lock<FirstLock> l_other_first{other.first_lock, std::defer_lock};
+        std::lock(l_first, l_other_first);
 
-        self_ptr->ptr = other.self_ptr->ptr;
-        *self_ptr = this;
+        std::swap(first, other.first);
+        free_list.swap(other.free_list);
+
+        // chunks keep pointing to their SelfPtr - so it goes with chunks
+        std::swap(self_ptr, other.self_ptr);
+        self_ptr->ptr = this;
+        other.self_ptr->ptr = &other;       // release maintenance
+
+        std::swap(chunk_pool, other.chunk_pool);
+
+        max_bytes = other.max_bytes.exchange(max_bytes.load());
+        std::swap(high_water_mark, other.high_water_mark);
+        std::swap(high_water_callback, other.high_water_callback);
+        above_high_water = other.above_high_water.exchange(above_high_water.load());
     }
 
-    // may block, till all trackable_iterators will be released
+    // may block, till all trackable_iterators will be released (unless Policy::deferred_teardown)
     ~SyncedChunkedArray() {
-        std::unique_lock<typename SelfPtr::Lock> l_other(self_ptr->lock);
-        self_ptr->ptr = nullptr;
+        self_ptr->store(nullptr);
 
+        std::shared_ptr<Chunk> chunk;
         {
             std::unique_lock<FirstLock> l(first_lock);
-            std::shared_ptr<Chunk> chunk = first;
-            while (chunk) {
-                std::shared_ptr<Chunk> next;
-                {
-                    // fixed lock order
-                    std::unique_lock<typename Chunk::Lock> l_chunk(chunk->lock);
-                    std::unique_lock<typename Chunk::MaintanceLock> l_maintain(chunk->maintance_lock);
+            chunk = std::move(first);
+        }
+
+        if constexpr (Policy::deferred_teardown) {
+            if (!chunk) return;
+            SyncedChunkedArrayReclaimer::instance().defer([chunk = std::move(chunk)]() mutable {
+                teardown(std::move(chunk));
+            });
+        } else {
+            teardown(std::move(chunk));
+        }
+    }
+
+private:
+    // unlink and destroy all chunks, starting from first
+    static void teardown(std::shared_ptr<Chunk> chunk) {
+        while (chunk) {
+            std::shared_ptr<Chunk> next;
+            {
+                // fixed lock order
+                std::unique_lock<typename Chunk::Lock> l_chunk(chunk->lock);
+                std::unique_lock<typename Chunk::MaintanceLock> l_maintain(chunk->maintance_lock);
+
+                std::unique_lock<typename SelfPtr::LinksLock> l_links(chunk->self_ptr->links_lock);
+                next = std::atomic_load(&chunk->next);
+                const std::shared_ptr<Chunk> chunk_null{nullptr};
+                std::atomic_store(&chunk->next, chunk_null);
+                std::atomic_store(&chunk->prev, chunk_null);
+                chunk->self_ptr->unlink(chunk.get());
+            }
+
+            chunk = std::move(next);
+        }
+    }
+
+    // Budget, in chunks footprint bytes. Checked only at chunk allocation, by try_emplace/emplace_wait.
+    std::atomic<std::size_t> max_bytes{std::numeric_limits<std::size_t>::max()};
+
+    std::size_t high_water_mark{std::numeric_limits<std::size_t>::max()};
+    std::function<void(std::size_t chunks_count)> high_water_callback;
+    std::atomic<bool> above_high_water{false};
+
+    // Small first chunk about to be absorbed by new one - released_capacity, not counted.
+    // (If absorb fails - chunk locked - budget exceeded by it, till merged away.)
+    // At least one chunk always allowed.
+    bool budget_allow_chunk(std::size_t capacity, std::size_t released_capacity = 0) const {
+        const std::size_t released_bytes = released_capacity == 0 ? 0 : Chunk::footprint(released_capacity);
+        const std::size_t other_bytes = self_ptr->chunks_bytes.load() - released_bytes;
+        return other_bytes == 0 || other_bytes + Chunk::footprint(capacity) <= max_bytes.load();
+    }
+
+    // return true, if high water mark just reached
+    bool check_high_water() {
+        if (self_ptr->chunks_count.load() < high_water_mark) {
+            if (above_high_water.load(std::memory_order_relaxed)) above_high_water = false;
+            return false;
+        }
+        return !above_high_water.exchange(true);
+    }
+
+    // construct(Chunk*) -> index; called under chunk maintance lock
+    // budgeted - return nullopt, if new chunk needed, but budget exceeded.
+    template<class Construct>
+    auto do_emplace(Construct &&construct, bool budgeted = false) {
+        Chunk *chunk;       // can't be merged/deleted while under lock
+
+		using ULMaintance = std::unique_lock<typename Chunk::MaintanceLock>;
+		ULMaintance l_maintance;
+
+        auto make_result = [](ULMaintance &&l_maintance, Chunk *chunk, std::size_t index) {
+            return [l = std::move(l_maintance), chunk, index]() -> trackable_iterator {
+                return {chunk, index};
+            };
+        };
+        using Result = std::optional<decltype(make_result(std::declval<ULMaintance>(), nullptr, 0))>;
+
+        bool high_water_reached = false;
+
+        chunk = free_list.get_first_under_maintance_lock(l_maintance);
+
+        if (!chunk) {
+            std::unique_lock<FirstLock> l(first_lock);
+
+            if (!first) {
+                if (budgeted && !budget_allow_chunk(first_chunk_capacity)) return Result{};
+
+                first = make_chunk(first_chunk_capacity);
+                first->is_first = true;
+                high_water_reached = check_high_water();
+            }
+
+            l_maintance = ULMaintance(first->maintance_lock);
+            if (first->is_full()) {
+                const std::size_t capacity = std::min(chunk_size_t, first->capacity * 4);
+                const bool absorbs = !Policy::stable && first->capacity < chunk_size_t;
+                if (budgeted && !budget_allow_chunk(capacity, absorbs ? first->capacity : 0)) return Result{};
+
+                auto chunk = make_chunk(capacity);
+                high_water_reached = check_high_water();
+                chunk->is_first = true;
+
+                if (first->capacity == chunk_size_t || !absorb(chunk.get(), first.get(), l_maintance)) {
+                    std::unique_lock<typename SelfPtr::LinksLock> l_links(self_ptr->links_lock);
+                    std::atomic_store(&chunk->next, first);
+                    std::atomic_store(&first->prev, chunk);
+                }
+
+                auto prev_first = std::move(first); // keep first alive till unlock
+                    first = std::move(chunk);
+                prev_first->is_first = false;
+
+                l_maintance = ULMaintance(first->maintance_lock);
+            }
+
+            chunk = first.get();
+        }
+
+
+        const std::size_t index = construct(chunk);
+
+        if (chunk->in_free_list && chunk->is_full()) {
+            free_list.erase(chunk, l_maintance);
+        }
+
+        self_ptr->notify_takers();
+
+        if (high_water_reached && high_water_callback) {
+            high_water_callback(self_ptr->chunks_count.load());
+        }
+
+        return Result{make_result(std::move(l_maintance), chunk, index)};
+    }
+
+public:
+    template<class ...Args>
+    auto emplace(Args&&...args) {
+        if constexpr (Policy::ttl) {
+            return emplace_until(time_point::max(), std::forward<Args>(args)...);
+        } else {
+            return std::move(*do_emplace([&](Chunk *chunk) {
+                return chunk->emplace(std::forward<Args>(args)...);
+            }));
+        }
+    }
+
+    // same as emplace, but fail (return empty optional), if new chunk needed and budget exceeded.
+    template<class ...Args>
+    auto try_emplace(Args&&...args) {
+        return do_emplace([&](Chunk *chunk) {
+            const std::size_t index = chunk->emplace(std::forward<Args>(args)...);
+            if constexpr (Policy::ttl) {
+                chunk->set_expiry(index, time_point::max());
+            }
+            return index;
+        }, true);
+    }
+
+    // same as emplace, but if new chunk needed and budget exceeded - block until erasures free some space.
+    template<class ...Args>
+    auto emplace_wait(Args&&...args) {
+        auto construct = [&](Chunk *chunk) {
+            const std::size_t index = chunk->emplace(std::forward<Args>(args)...);
+            if constexpr (Policy::ttl) {
+                chunk->set_expiry(index, time_point::max());
+            }
+            return index;
+        };
+
+        self_ptr->budget_waiters++;
+        while (true) {
+            std::size_t epoch;
+            {
+                std::unique_lock<std::mutex> l(self_ptr->budget_mutex);
+                epoch = self_ptr->budget_epoch;
+            }
+
+            auto result = do_emplace(construct, true);
+            if (result) {
+                self_ptr->budget_waiters--;
+                return std::move(*result);
+            }
+
+            // we were registered before do_emplace - slots freed after it change epoch
+            std::unique_lock<std::mutex> l(self_ptr->budget_mutex);
+            self_ptr->budget_cv.wait(l, [&]() {
+                return self_ptr->budget_epoch != epoch;
+            });
+        }
+    }
+
+    // max memory occupied by chunks (small first chunks counted by their actual size). At least one chunk always allowed.
+    void set_memory_budget(std::size_t bytes) {
+        max_bytes = bytes;
+        self_ptr->notify_budget();
+    }
+
+    // max elements, rounded up to chunk size - as memory of that many full chunks
+    void set_elements_budget(std::size_t elements) {
+        max_bytes = (elements + chunk_size_t - 1) / chunk_size_t * Chunk::footprint(chunk_size_t);
+        self_ptr->notify_budget();
+    }
+
+    // callback(chunks_count) called from emplace, when chunks count reaches high_water_mark_chunks.
+    // Called once, until chunks count fall below mark. Must not emplace to this container.
+    // Not thread-safe, set before use.
+    void set_high_water_mark(std::size_t high_water_mark_chunks, std::function<void(std::size_t chunks_count)> callback) {
+        high_water_mark = high_water_mark_chunks;
+        high_water_callback = std::move(callback);
+    }
+
+    // Return memory of chunks, pooled more than `idle` ago, to OS (madvise). Virtual memory stays reserved,
+    // so reuse is cheap. Return trimmed chunks count. Call periodically, from any thread.
+    std::size_t trim(typename clock::duration idle = clock::duration::zero()) {
+        static_assert(Policy::chunk_pool_capacity > 0, "Policy::chunk_pool_capacity must be > 0");
+        return chunk_pool->trim(idle);
+    }
+
+    std::size_t get_pooled_chunks_count() const {
+        return chunk_pool ? chunk_pool->size() : 0;
+    }
+
+    // chunks allocated (including not yet destroyed removed ones)
+    std::size_t get_allocated_chunks_count() const {
+        return self_ptr->chunks_count.load();
+    }
+
+    // same as emplace, but element will be erased by expire(), when expiry time reached
+    template<class ...Args>
+    auto emplace_until(time_point expiry, Args&&...args) {
+        static_assert(Policy::ttl, "Policy::ttl must be true");
+        return std::move(*do_emplace([&](Chunk *chunk) {
+            const std::size_t index = chunk->emplace(std::forward<Args>(args)...);
+            chunk->set_expiry(index, expiry);
+            return index;
+        }));
+    }
+
+    // reinitialize recycled element in-place with init(T&). If there is no recycled element at place,
+    // default construct it first.
+    template<class Init>
+    auto emplace_recycled(Init &&init) {
+        static_assert(Policy::recycle, "Policy::recycle must be true");
+        return std::move(*do_emplace([&](Chunk *chunk) {
+            const std::size_t index = chunk->emplace_recycled(init);
+            if constexpr (Policy::ttl) {
+                chunk->set_expiry(index, time_point::max());
+            }
+            return index;
+        }));
+    }
+
+    void erase(const Iterator &iter) {
+        iter.chunk->erase(iter.index);
+
+        if (settings::erase_immideatley){
+            if (iter.chunk->lock.try_lock()){
+                maintain_and_unlock<false>(iter.chunk, this);
+            }
+        }
+    }
+
+    void erase(const trackable_iterator &iter) {
+        auto ptr = iter.lock();
+        if (!ptr) return;
+
+        erase(Iterator{iter.chunk, iter.index});
+    }
+
+    // Move element to `to` (same type container). trackable_iterators follow element, Policy::on_relocate called.
+    // Source place erased as usual (Policy::on_destroy will see moved-from element).
+    // Return false if element already dead. Do not hold `to` emplace results while transfer - may deadlock.
+    bool transfer(const trackable_iterator &iter, SyncedChunkedArray &to) {
+        auto ptr = iter.lock();
+        if (!ptr) return false;
+        if (&to == this) return true;
+
+        Chunk *chunk_from = iter.chunk;
+        const std::size_t index_from = iter.index;
+
+        // source chunk lock -> target maintance lock; same order as maintenance
+        to.do_emplace([&](Chunk *chunk_to) {
+            const std::size_t index_to = chunk_to->emplace(std::move(chunk_from->array()[index_from]));
+            track_move_element(chunk_from, index_from, chunk_to, index_to);
+
+            if constexpr (Policy::ttl) {
+                const auto rep = chunk_from->expiry.at[index_from].load();
+                chunk_to->expiry.at[index_to].store(rep);
+                chunk_to->expiry.update_earliest(rep);
+            }
+
+            Policy::on_relocate(chunk_to->array()[index_to], Iterator{chunk_from, index_from}, Iterator{chunk_to, index_to});
+            return index_to;
+        });
+
+        chunk_from->erase(index_from);
+        return true;
+    }
+
+    // prolong/shorten element life
+    void set_expiry(const Iterator &iter, time_point expiry) {
+        static_assert(Policy::ttl, "Policy::ttl must be true");
+        iter.chunk->set_expiry(iter.index, expiry);
+    }
 
-                    next = std::atomic_load(&chunk->next);
-                    chunk->next = nullptr;
-                    chunk->prev = nullptr;
-                }
+    void set_expiry(const trackable_iterator &iter, time_point expiry) {
+        auto ptr = iter.lock();
+        if (!ptr) return;
 
-                chunk = std::move(next);
-            }
-        }
+        set_expiry(Iterator{iter.chunk, iter.index}, expiry);
     }
 
-    template<class ...Args>
-    auto emplace(Args&&...args) {
-        Chunk *chunk;       // can't be merged/deleted while under lock
+    // erase all elements with expiry <= now. Visit only chunks, which have expired elements.
+    // return number of erased elements
+    std::size_t expire(time_point now = clock::now()) {
+        static_assert(Policy::ttl, "Policy::ttl must be true");
+        const typename Chunk::ExpiryRep now_rep = now.time_since_epoch().count();
 
-		using ULMaintance = std::unique_lock<typename Chunk::MaintanceLock>;
-		ULMaintance l_maintance;
+        std::size_t expired = 0;
+        auto expire_and_unlock = [&](Chunk *chunk) {
+            {
+                std::unique_lock<typename Chunk::MaintanceLock> l_m(chunk->maintance_lock);
+                expired += chunk->expire(now);
+            }
+            maintain_and_unlock<false>(chunk, this);
+        };
 
-        chunk = free_list.get_first_under_maintance_lock(l_maintance);
+        std::vector<std::shared_ptr<Chunk>> skipped;
 
-        if (!chunk) {
+        std::shared_ptr<Chunk> chunk;
+        {
             std::unique_lock<FirstLock> l(first_lock);
-
-            if (!first) {
-                first = std::make_shared<Chunk>(self_ptr);
-                first->is_first = true;
+            chunk = first;
+        }
+        while (chunk) {
+            if (chunk->expiry.earliest <= now_rep) {
+                if (chunk->lock.try_lock()) {
+                    expire_and_unlock(chunk.get());
+                } else {
+                    skipped.emplace_back(chunk);
+                }
             }
 
-            l_maintance = ULMaintance(first->maintance_lock);
-            if (first->is_full()) {
-                auto chunk = std::make_shared<Chunk>(self_ptr);
-
-                chunk->next = first;
-                std::atomic_store(&first->prev, chunk);
-                chunk->is_first = true;
+            chunk = std::atomic_load(&chunk->next);
+        }
 
-                auto prev_first = std::move(first); // keep first alive till unlock
-                    first = std::move(chunk);
-                prev_first->is_first = false;
+        // loop on skipped
+        while (!skipped.empty()) {
+            for (std::size_t i = 0; i < skipped.size();) {
+                std::shared_ptr<Chunk> &chunk = skipped[i];
+                if (chunk->lock.try_lock()) {
+                    expire_and_unlock(chunk.get());
 
-                l_maintance = ULMaintance(first->maintance_lock);
+                    // unordered remove from list
+                    if (chunk != skipped.back()) chunk = std::move(skipped.back());
+                    skipped.pop_back();
+                } else {
+                    i++;
+                }
             }
-
-            chunk = first.get();
+            if (!skipped.empty()) std::this_thread::yield();
         }
 
+        return expired;
+    }
 
-        const std::size_t index = chunk->emplace(std::forward<Args>(args)...);
-
+private:
+    // Chunk::iterate under unique lock, letting trackable_iterator::lock() waiters in, see Policy::iterate_yield_*.
+    // Not at nested level - lock would not be released.
+    template<class Closure>
+    static void iterate_yielding(Chunk *chunk, Closure &&closure) {
+        using yield_clock = std::chrono::steady_clock;
+        std::size_t since_yield = 0;
+        yield_clock::time_point last_yield;
+        if constexpr (Policy::iterate_yield_interval.count() > 0) last_yield = yield_clock::now();
+
+        auto yield_due = [&]() {
+            if (Policy::iterate_yield_elements > 0 && ++since_yield >= Policy::iterate_yield_elements) return true;
+            if constexpr (Policy::iterate_yield_interval.count() > 0) {
+                if (yield_clock::now() - last_yield >= Policy::iterate_yield_interval) return true;
+            }
+            return false;
+        };
 
-        if (chunk->in_free_list && chunk->is_full()) {
-            free_list.erase(chunk, l_maintance);
-        }
+        const std::size_t size = chunk->size;
+        for (std::size_t i = 0; i < size; i++) {
+            if (!chunk->is_alive_fast_check(i)) continue;
+            closure(Iterator{chunk, i});
 
-        return [l = std::move(l_maintance), chunk, index]() -> trackable_iterator {
-            return {chunk, index};
-        };
-    }
+            if (!yield_due()) continue;
+            since_yield = 0;
+            if constexpr (Policy::iterate_yield_interval.count() > 0) last_yield = yield_clock::now();
 
-    void erase(const Iterator &iter) {
-        iter.chunk->erase(iter.index);
+            if (chunk->lock_waiters.load(std::memory_order_relaxed) == 0 || chunk->lock.level() != 1) continue;
 
-        if (settings::erase_immideatley){
-            if (iter.chunk->lock.try_lock()){
-                maintain_and_unlock<false>(iter.chunk, this);
-            }
+            chunk->paused++;
+            chunk->lock.unlock();
+            std::this_thread::yield();
+            chunk->lock.lock();
+            chunk->paused--;
         }
     }
 
-    void erase(const trackable_iterator &iter) {
-        auto ptr = iter.lock();
-        if (!ptr) return;
-
-        erase(Iterator{iter.chunk, iter.index});
+    // Move elements in, in bulk: each target chunk filled under one maintance lock.
+    void emplace_buffered(std::vector<T> &elements) {
+        std::size_t i = 0;
+        while (i < elements.size()) {
+            do_emplace([&](Chunk *chunk) {
+                std::size_t index;
+                do {
+                    index = chunk->emplace(std::move(elements[i++]));
+                    if constexpr (Policy::ttl) {
+                        chunk->set_expiry(index, time_point::max());
+                    }
+                } while (i < elements.size() && !chunk->is_full());
+                return index;
+            });
+        }
+        elements.clear();
     }
 
-    // unordered iteration
+public:
+    // unordered iteration. closure(iter), or closure(iter, EmplaceContext&)
     template<bool shared = false, class Closure>
     void iterate(Closure &&closure) {
+        constexpr const bool with_context = std::is_invocable<Closure &, Iterator, EmplaceContext &>::value;
+        EmplaceContext context;
+
+        auto visit = [&](auto &&iter) {
+            if constexpr (with_context) {
+                closure(std::forward<decltype(iter)>(iter), context);
+            } else {
+                closure(std::forward<decltype(iter)>(iter));
+            }
+        };
+
         std::vector<std::shared_ptr<Chunk>> skipped;    // TODO: put to thread_local / or use small_vector
 
 
@@ -677,7 +1963,11 @@ public:
 
 
         auto iterate_and_unlock = [&](Chunk *chunk) {
-            chunk->iterate(closure);
+            if constexpr (iterate_yields && !shared) {
+                iterate_yielding(chunk, visit);
+            } else {
+                chunk->iterate(visit);
+            }
             maintain_and_unlock<shared>(chunk, this);
         };
 
@@ -694,6 +1984,7 @@ public:
                     if (try_lock_chunk(chunk.get())) {
                         iterate_and_unlock(chunk.get());
                     } else {
+                        self_ptr->count(SelfPtr::lock_contention);
                         skipped.emplace_back(chunk);
                     }
                 } else {
@@ -721,6 +2012,10 @@ public:
             }
             std::this_thread::yield();
         }
+
+        if constexpr (with_context) {
+            emplace_buffered(context.buffer);
+        }
     }
 
     template<bool shared = false, class Closure>
@@ -728,6 +2023,315 @@ public:
         iterate<true>(std::forward<Closure>(closure));
     };
 
+    // Commutative concurrent updates: chunks pinned with shared lock (maintenance needs unique lock, so nothing
+    // relocates), closure(AtomicView) updates designated fields with view.atomic(&T::field). Threads updating
+    // the same chunk do not serialize. Plain access to such fields only under exclusive iterate()/lock();
+    // shared readers (iterate_shared(), lock_shared()) must use atomics too.
+    template<class Closure>
+    void iterate_relaxed(Closure &&closure) {
+        iterate<true>([&](const Iterator &iter) {
+            closure(AtomicView{iter.chunk, iter.index});
+        });
+    }
+
+    // Unordered MPMC bag. Move out and erase up to n elements: closure(T&&). Return taken count.
+    // Start from chunk, this thread shard took from last time (consumers spread over chunks), then steal from others.
+    // Take from chunk end - compaction after that just cuts size. Return 0 only if all chunks seen empty.
+    template<class Closure>
+    std::size_t take_batch(std::size_t n, Closure &&closure) {
+        if (n == 0) return 0;
+
+        std::size_t taken = 0;
+        std::shared_ptr<Chunk> last_taken;
+        auto take_and_unlock = [&](const std::shared_ptr<Chunk> &chunk) {
+            const std::size_t taken_before = taken;
+            for (std::size_t i = chunk->size; i-- > 0 && taken < n;) {
+                if (!chunk->is_alive_fast_check(i)) continue;
+                closure(std::move(chunk->array()[i]));
+                chunk->erase(i);
+                taken++;
+            }
+            if (taken > taken_before) last_taken = chunk;
+            maintain_and_unlock<false>(chunk.get(), this);
+        };
+
+        std::vector<std::shared_ptr<Chunk>> skipped;
+        auto visit = [&](const std::shared_ptr<Chunk> &chunk) {
+            if (chunk->lock.try_lock()) {
+                take_and_unlock(chunk);
+            } else {
+                self_ptr->count(SelfPtr::lock_contention);
+                skipped.emplace_back(chunk);
+            }
+        };
+
+        std::shared_ptr<Chunk> head;
+        {
+            std::unique_lock<FirstLock> l(first_lock);
+            head = first;
+        }
+
+        std::shared_ptr<Chunk> start;
+        {
+            std::unique_lock<typename SelfPtr::LinksLock> l_links(self_ptr->links_lock);
+            if (Chunk *hint = self_ptr->take_hints[SelfPtr::shard_index()]) start = hint->shared_from_this();
+        }
+        if (!start) {
+            // first time - spread threads by shard
+            start = head;
+            for (std::size_t i = SelfPtr::shard_index(); i > 0 && start; i--) {
+                std::shared_ptr<Chunk> next = std::atomic_load(&start->next);
+                if (!next) break;
+                start = std::move(next);
+            }
+        }
+
+        // start -> end, then head -> start
+        for (std::shared_ptr<Chunk> chunk = start; chunk && taken < n; chunk = std::atomic_load(&chunk->next)) {
+            visit(chunk);
+        }
+        for (std::shared_ptr<Chunk> chunk = head; chunk && chunk != start && taken < n; chunk = std::atomic_load(&chunk->next)) {
+            visit(chunk);
+        }
+
+        // loop on skipped
+        while (taken < n && !skipped.empty()) {
+            for (std::size_t i = 0; i < skipped.size() && taken < n;) {
+                std::shared_ptr<Chunk> &chunk = skipped[i];
+                if (chunk->lock.try_lock()) {
+                    take_and_unlock(chunk);
+
+                    // unordered remove from list
+                    if (chunk != skipped.back()) chunk = std::move(skipped.back());
+                    skipped.pop_back();
+                } else {
+                    i++;
+                }
+            }
+            if (taken < n && !skipped.empty()) std::this_thread::yield();
+        }
+
+        if (last_taken) {
+            std::unique_lock<typename SelfPtr::LinksLock> l_links(self_ptr->links_lock);
+            if (!last_taken->unlinked) self_ptr->take_hints[SelfPtr::shard_index()] = last_taken.get();
+        }
+        return taken;
+    }
+
+    std::optional<T> try_take() {
+        std::optional<T> result;
+        take_batch(1, [&](T &&element) { result.emplace(std::move(element)); });
+        return result;
+    }
+
+    // same as take_batch, but if container empty - block until emplace, or timeout. Return 0 on timeout.
+    template<class Closure, class Rep, class Period>
+    std::size_t take_batch_wait(std::size_t n, Closure &&closure, std::chrono::duration<Rep, Period> timeout) {
+        const std::chrono::steady_clock::time_point deadline =
+                std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(timeout);
+
+        self_ptr->take_waiters++;
+        std::size_t taken;
+        while (true) {
+            std::size_t epoch;
+            {
+                std::unique_lock<std::mutex> l(self_ptr->take_mutex);
+                epoch = self_ptr->take_epoch;
+            }
+
+            taken = take_batch(n, closure);
+            if (taken > 0) break;
+
+            if (std::chrono::steady_clock::now() >= deadline) break;
+
+            // we were registered before take_batch - emplace after it changes epoch
+            std::unique_lock<std::mutex> l(self_ptr->take_mutex);
+            self_ptr->take_cv.wait_until(l, deadline, [&]() {
+                return self_ptr->take_epoch != epoch;
+            });
+        }
+        self_ptr->take_waiters--;
+        return taken;
+    }
+
+    template<class Rep, class Period>
+    std::optional<T> take_wait(std::chrono::duration<Rep, Period> timeout) {
+        std::optional<T> result;
+        take_batch_wait(1, [&](T &&element) { result.emplace(std::move(element)); }, timeout);
+        return result;
+    }
+
+private:
+    static const trackable_iterator &as_trackable(const trackable_iterator &iter) { return iter; }
+
+    template<class Ptr>
+    static const trackable_iterator &as_trackable(const Ptr &ptr) { return *ptr; }
+
+public:
+    // Visit elements of many trackable_iterators at once. Elements grouped by chunk,
+    // thus each chunk locked and maintained once, instead of once per element.
+    // range - of trackable_iterator, or pointers to trackable_iterator.
+    // closure(Iterator) - same as in iterate(). Dead elements skipped.
+    template<bool shared = false, class Range, class Closure>
+    void for_each_tracked(Range &&range, Closure &&closure) {
+        struct Target {
+            std::shared_ptr<Chunk> chunk;   // keep alive, till locked
+            const trackable_iterator *iter;
+        };
+        std::vector<Target> targets;
+        for (auto &&item : range) {
+            targets.push_back({nullptr, &as_trackable(item)});
+        }
+
+        std::vector<Target> left;
+        while (!targets.empty()) {
+            // snapshot chunks
+            {
+                std::shared_ptr<Chunk> last;
+                for (Target &target : targets) {
+                    std::unique_lock<typename trackable_iterator::Lock> l(target.iter->m_lock);
+                    Chunk *chunk = target.iter->chunk;
+                    if (!chunk) {
+                        target.chunk = nullptr;
+                        continue;
+                    }
+                    if (last.get() != chunk) last = chunk->weak_from_this().lock();     // null, if in destruction
+                    target.chunk = last;
+                }
+            }
+
+            std::sort(targets.begin(), targets.end(), [](const Target &l, const Target &r) {
+                return l.chunk < r.chunk;
+            });
+
+            const std::size_t size = targets.size();
+            std::size_t group_begin = 0;
+            while (group_begin < size) {
+                Chunk *chunk = targets[group_begin].chunk.get();
+                std::size_t group_end = group_begin + 1;
+                while (group_end < size && targets[group_end].chunk.get() == chunk) group_end++;
+
+                if (!chunk) {
+                    // dead
+                } else if (!(shared ? chunk->lock.try_lock_shared() : chunk->lock.try_lock())) {
+                    for (std::size_t i = group_begin; i < group_end; i++) left.emplace_back(std::move(targets[i]));
+                } else {
+                    for (std::size_t i = group_begin; i < group_end; i++) {
+                        const trackable_iterator *iter = targets[i].iter;
+
+                        std::size_t index;
+                        {
+                            std::unique_lock<typename trackable_iterator::Lock> l(iter->m_lock);
+                            if (iter->chunk != chunk) {
+                                // moved before we lock
+                                if (iter->chunk) left.push_back({nullptr, iter});
+                                continue;
+                            }
+                            index = iter->index;
+                        }
+
+                        if (!chunk->is_alive_fast_check(index)) continue;
+                        closure(Iterator{chunk, index});
+                    }
+                    maintain_and_unlock<shared>(chunk, this);
+                }
+
+                group_begin = group_end;
+            }
+
+            const bool progress = left.size() < targets.size();
+            targets.clear();
+            std::swap(targets, left);
+
+            if (!progress) std::this_thread::yield();
+        }
+    }
+
+    // Reach elements of trackable_iterators one by one, keeping last chunk locked - consecutive elements of the
+    // same chunk cost no chunk lock, refcount or maintance (see SyncedChunkedJoin). Chunks only try-locked,
+    // never waits. At most one chunk held, till element of other chunk requested, or release().
+    // Single thread, short-lived.
+    class tracked_cursor {
+        Self &array;
+        std::shared_ptr<Chunk> chunk;       // locked
+
+    public:
+        enum class Status { ok, busy, expired };
+
+        explicit tracked_cursor(Self &array)
+                : array(array) {}
+
+        tracked_cursor(const tracked_cursor &) = delete;
+
+        ~tracked_cursor() {
+            release();
+        }
+
+        // element of iter, or nullptr (status - busy or expired)
+        T *try_get(const trackable_iterator &iter, Status &status) {
+            std::size_t index;
+            {
+                std::unique_lock<typename trackable_iterator::Lock> l(iter.m_lock);
+                if (!iter.chunk) {
+                    status = Status::expired;
+                    return nullptr;
+                }
+                // element can't leave chunk we hold
+                if (iter.chunk == chunk.get()) {
+                    index = iter.index;
+                    status = chunk->is_alive_fast_check(index) ? Status::ok : Status::expired;
+                    return status == Status::ok ? &chunk->array()[index] : nullptr;
+                }
+            }
+
+            // maintain held one without m_lock - maintance takes trackable locks
+            release();
+
+            std::shared_ptr<Chunk> chunk_self;
+            {
+                std::unique_lock<typename trackable_iterator::Lock> l(iter.m_lock);
+                if (!iter.chunk) {
+                    status = Status::expired;
+                    return nullptr;
+                }
+                chunk_self = iter.chunk_self();
+                if (!chunk_self) {
+                    status = Status::expired;
+                    return nullptr;
+                }
+                if (!chunk_self->lock.try_lock()) {
+                    status = Status::busy;
+                    return nullptr;
+                }
+                index = iter.index;
+            }
+            chunk = std::move(chunk_self);
+
+            status = chunk->is_alive_fast_check(index) ? Status::ok : Status::expired;
+            return status == Status::ok ? &chunk->array()[index] : nullptr;
+        }
+
+        void release() {
+            if (!chunk) return;
+            maintain_and_unlock<false>(chunk.get(), &array);
+            chunk = nullptr;
+        }
+    };
+
+    // No locks, no maintance, no refcounting. Only for containers, which nobody modify concurrently
+    // (see SyncedChunkedPublished).
+    template<class Closure>
+    void iterate_unsynced(Closure &&closure) const {
+        for (const Chunk *chunk = first.get(); chunk; chunk = chunk->next.get()) {
+            const std::size_t size = chunk->size.load(std::memory_order_relaxed);
+            for (std::size_t i = 0; i < size; i++) {
+                if (!chunk->aliveness[i].load(std::memory_order_relaxed)) continue;
+                const Iterator iter{const_cast<Chunk *>(chunk), i};
+                closure(iter);
+            }
+        }
+    }
+
     std::size_t get_chunks_count() {
         std::shared_ptr < Chunk > chunk;
         {
@@ -743,6 +2347,35 @@ public:
         return count;
     }
 
+    // Does not lock chunks - cheap enough for periodic scraping. Gauges may be slightly off, under concurrent modification.
+    SyncedChunkedArrayMetrics metrics() {
+        SyncedChunkedArrayMetrics metrics;
+
+        std::shared_ptr < Chunk > chunk;
+        {
+            std::unique_lock<FirstLock> l(first_lock);
+            chunk = first;
+        }
+        while (chunk) {
+            const std::size_t size = chunk->size.load(std::memory_order_relaxed);
+            const std::size_t deleted = std::min(size, chunk->deleted_count.load(std::memory_order_relaxed));
+            const std::size_t holes = std::min(size - deleted, std::size_t(chunk->holes.count));
+            metrics.elements += size - deleted - holes;
+            metrics.erased   += deleted;
+            metrics.chunks++;
+            metrics.capacity += chunk->capacity;
+            chunk = std::atomic_load(&chunk->next);
+        }
+        metrics.free_list_chunks = free_list.size();
+
+        metrics.compactions     = self_ptr->get_count(SelfPtr::compaction);
+        metrics.merges          = self_ptr->get_count(SelfPtr::merge);
+        metrics.chunks_released = self_ptr->get_count(SelfPtr::chunk_released);
+        metrics.lock_contention = self_ptr->get_count(SelfPtr::lock_contention);
+
+        return metrics;
+    }
+
 
     class trackable_iterator {
         friend Self;
@@ -759,6 +2392,29 @@ public:
         using Lock = threading::SpinLock<threading::SpinLockMode::Nonstop>;
         mutable Lock m_lock;
 
+        // Policy::iterate_yield_*. lock() counted in chunk->lock_waiters. Under m_lock.
+        // Not a chunk reference - counter moves with element (see track_move_element), chunk alive while we point to it.
+        mutable bool lock_waiting{false};
+
+        void start_waiting(Chunk *chunk) const {
+            if constexpr (iterate_yields) {
+                if (lock_waiting) return;
+                chunk->lock_waiters++;
+                lock_waiting = true;
+            }
+        }
+
+        // return true if was waiting
+        bool stop_waiting(Chunk *chunk) const {
+            if constexpr (iterate_yields) {
+                if (!lock_waiting) return false;
+                chunk->lock_waiters--;
+                lock_waiting = false;
+                return true;
+            }
+            return false;
+        }
+
 
         trackable_iterator(Chunk *chunk, std::size_t index)
                 : chunk(chunk), index(index) {
@@ -879,11 +2535,18 @@ public:
 
             Chunk *chunk;
             T *ptr;
+            std::shared_ptr<Chunk> chunk_self;      // unlinked chunk may lose all other references, while we hold its lock
 
-            access(Chunk *chunk, T *ptr)
-                    : chunk(chunk), ptr(ptr) {}
+            access(Chunk *chunk, T *ptr, std::shared_ptr<Chunk> chunk_self = nullptr)
+                    : chunk(chunk), ptr(ptr), chunk_self(std::move(chunk_self)) {}
 
         public:
+            access(const access &) = delete;
+            access(access &&other)
+                    : chunk(other.chunk), ptr(other.ptr), chunk_self(std::move(other.chunk_self)) {
+                other.chunk = nullptr;
+            }
+
             operator bool() const {
                 return chunk != nullptr;
             }
@@ -900,20 +2563,43 @@ public:
                 return *get();
             }
 
+            // see atomic_view()
+            template<class U, class Element>
+            SyncedChunkedArrayAtomicRef<U> atomic(U Element::*field) const {
+                return SyncedChunkedArrayAtomicRef<U>(ptr->*field);
+            }
+
             ~access() {
                 if (!chunk) return;
 
-                Self::maintain_and_unlock<shared>(chunk);       // chunk may be deleted after maintain
+                Self::maintain_and_unlock<shared>(chunk);       // chunk may be unlinked, destroyed with chunk_self
             }
         };
 
+        // under m_lock. Chunk reference for access, null if chunk in destruction (element dies with it).
+        // Our chunk can't finish destruction meanwhile - it has to null us under m_lock first.
+        std::shared_ptr<Chunk> chunk_self() const {
+            return chunk->weak_from_this().lock();
+        }
+
         template<bool shared = false>
         access<shared> lock() const {
+            std::shared_ptr<Chunk> chunk_self;
             while (true) {
-                std::unique_lock<Lock> l(m_lock);
-                if (!chunk) return {nullptr, nullptr};
+                {
+                    std::unique_lock<Lock> l(m_lock);
+                    if (!chunk) return {nullptr, nullptr};
 
-                if (shared ? chunk->lock.try_lock_shared() : chunk->lock.try_lock()) break;
+                    if (chunk_self.get() != chunk) chunk_self = this->chunk_self();
+                    if (chunk_self && (shared ? chunk->lock.try_lock_shared() : chunk->lock.try_lock())) {
+                        stop_waiting(chunk);
+                        break;
+                    }
+                    chunk->self_ptr->count(SelfPtr::lock_contention);
+                    // Policy::iterate_yield_* - announce ourselves to iterations
+                    start_waiting(chunk);
+                }
+                // yield with m_lock released - maintenance (holding chunk lock) may wait for it
                 std::this_thread::yield();
             }
 
@@ -924,12 +2610,100 @@ public:
                 }
             }
 
-            return {chunk, &chunk->array()[index]};
+            return {chunk, &chunk->array()[index], std::move(chunk_self)};
         }
 
         access<true> lock_shared() const {
             return lock<true>();
         }
+
+        // does not wait. Return empty access if chunk locked by someone else, or element dead (see expired())
+        template<bool shared = false>
+        access<shared> try_lock() const {
+            std::shared_ptr<Chunk> chunk_self;
+            {
+                std::unique_lock<Lock> l(m_lock);
+                if (!chunk) return {nullptr, nullptr};
+
+                chunk_self = this->chunk_self();
+                if (!chunk_self) return {nullptr, nullptr};
+                if (!(shared ? chunk->lock.try_lock_shared() : chunk->lock.try_lock())) return {nullptr, nullptr};
+            }
+
+            if (settings::trackable_iterator_check_aliveness) {
+                if (!chunk->is_alive_fast_check(index)) {
+                    shared ? chunk->lock.unlock_shared() : chunk->lock.unlock();
+                    return {nullptr, nullptr};
+                }
+            }
+
+            return {chunk, &chunk->array()[index], std::move(chunk_self)};
+        }
+
+        access<true> try_lock_shared() const {
+            return try_lock<true>();
+        }
+
+        // Flat combining, for hot elements. closure(T&) executed under chunk unique lock - by this thread, or by
+        // the one holding lock at the moment (it executes all published closures, before unlock). Blocks till executed.
+        // Closure must not throw, and must not access container. Return false, if element dead.
+        template<class Closure>
+        bool combine(Closure &&closure) const {
+            using ClosureType = std::remove_reference_t<Closure>;
+
+            CombineRequest request;
+            request.iter = this;
+            request.closure = const_cast<void *>(static_cast<const void *>(&closure));
+            request.run = [](void *closure, T &element) {
+                (*static_cast<ClosureType *>(closure))(element);
+            };
+
+            while (true) {
+                std::shared_ptr<Chunk> chunk;
+                {
+                    std::unique_lock<Lock> l(m_lock);
+                    if (!this->chunk) return false;
+                    chunk = this->chunk->weak_from_this().lock();      // null, if in destruction
+                }
+                if (!chunk) {
+                    std::this_thread::yield();
+                    continue;
+                }
+
+                // publish
+                request.state.store(CombineRequest::pending, std::memory_order_relaxed);
+                CombineRequest *head = chunk->combine_requests.load(std::memory_order_relaxed);
+                do {
+                    request.next = head;
+                } while (!chunk->combine_requests.compare_exchange_weak(head, &request, std::memory_order_release, std::memory_order_relaxed));
+
+                // executed by lock holder, or become one
+                while (request.state.load(std::memory_order_acquire) == CombineRequest::pending) {
+                    if (chunk->lock.try_lock()) {
+                        Self::maintain_and_unlock<false>(chunk.get());     // executes requests
+                    } else {
+                        std::this_thread::yield();
+                    }
+                }
+
+                const typename CombineRequest::State state = request.state;
+                if (state == CombineRequest::done) return true;
+                if (state == CombineRequest::dead) return false;
+                // moved - retry at new place
+            }
+        }
+
+        // Pin element chunk (shared lock - no relocation till release), for concurrent atomic(field) updates.
+        // Same as lock_shared(), named for intent.
+        access<true> atomic_view() const {
+            return lock<true>();
+        }
+
+        // true, if element destroyed
+        bool expired() const {
+            std::unique_lock<Lock> l(m_lock);
+            return chunk == nullptr;
+        }
     };
 
 };
@@ -0,0 +1,202 @@
+#pragma once
+
+/// Uniform grid spatial bucketing over SyncedChunkedArray. Each grid cell - own container (own chunk list),
+/// so region queries visit only overlapping cells - proportional to local density, not to total size.
+/// Element changing cell transferred between containers (see SyncedChunkedArray::transfer) -
+/// trackable_iterators stay valid.
+
+#include "SyncedChunkedArray.h"
+#include "threading/src/threading/RWSpinLock.h"
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <mutex>
+#include <shared_mutex>
+#include <type_traits>
+#include <utility>
+
+/// PositionOf - functor, return element position as std::array<Scalar, Dims>.
+/// Position must change only through update(), while element in grid.
+///
+///     struct PositionOf{ std::array<float, 2> operator()(const Entity &e) const { return {e.x, e.y}; } };
+///     SyncedChunkedGrid<PositionOf, Entities> grid(16.0f);
+///     auto entity = grid.emplace(x, y);
+///     grid.update(entity, [](Entity &e){ e.x += 1; });
+///     grid.iterate_region({{0, 0}, {32, 32}}, [](auto &&iter){ use(*iter); });
+template<class PositionOf, class Array>
+class SyncedChunkedGrid {
+public:
+    using value_type = typename Array::value_type;
+    using Position = std::decay_t<decltype(PositionOf{}(std::declval<const value_type &>()))>;
+    using Scalar = typename Position::value_type;
+    static constexpr const std::size_t dims = std::tuple_size<Position>::value;
+
+    using Iterator = typename Array::Iterator;
+    using trackable_iterator = typename Array::trackable_iterator;
+
+    // inclusive
+    struct Aabb {
+        Position min;
+        Position max;
+
+        bool contains(const Position &position) const {
+            for (std::size_t i = 0; i < dims; i++) {
+                if (position[i] < min[i] || max[i] < position[i]) return false;
+            }
+            return true;
+        }
+    };
+
+private:
+    using Cell = std::array<std::int64_t, dims>;
+
+    struct CellHash {
+        std::size_t operator()(const Cell &cell) const {
+            std::size_t hash = 0;
+            for (std::int64_t coord : cell) {
+                hash = (hash ^ std::size_t(coord)) * 0x9E3779B97F4A7C15ull;
+            }
+            return hash ^ (hash >> 32);
+        }
+    };
+
+    const Scalar cell_size;
+
+    // Never held while chunk locks taken (see iterate_region), so update() may take it under chunk lock.
+    // Cells never removed - Array addresses stable.
+    using Lock = threading::RWSpinLockWriterBiased<threading::SpinLockMode::Yield>;
+    Lock lock;
+    std::unordered_map<Cell, std::unique_ptr<Array>, CellHash> cells;
+
+    Cell cell_of(const Position &position) const {
+        Cell cell;
+        for (std::size_t i = 0; i < dims; i++) {
+            cell[i] = std::int64_t(std::floor(double(position[i]) / double(cell_size)));
+        }
+        return cell;
+    }
+
+    Array *find_cell(const Cell &cell) {
+        std::shared_lock<Lock> l(lock);
+        auto it = cells.find(cell);
+        return it == cells.end() ? nullptr : it->second.get();
+    }
+
+    Array &get_cell(const Cell &cell) {
+        if (Array *array = find_cell(cell)) return *array;
+
+        std::unique_lock<Lock> l(lock);
+        std::unique_ptr<Array> &array = cells[cell];
+        if (!array) array = std::make_unique<Array>();
+        return *array;
+    }
+
+    // cells overlapping aabb. Enumerate cell coords, or scan all cells - whichever is less.
+    std::vector<Array *> cells_in(const Aabb &aabb) {
+        const Cell lo = cell_of(aabb.min);
+        const Cell hi = cell_of(aabb.max);
+
+        double region_cells = 1;
+        for (std::size_t i = 0; i < dims; i++) {
+            if (hi[i] < lo[i]) return {};
+            region_cells *= double(hi[i] - lo[i] + 1);
+        }
+
+        std::vector<Array *> result;
+        std::shared_lock<Lock> l(lock);
+
+        if (region_cells > double(cells.size())) {
+            for (auto &cell : cells) {
+                bool inside = true;
+                for (std::size_t i = 0; i < dims; i++) {
+                    if (cell.first[i] < lo[i] || hi[i] < cell.first[i]) { inside = false; break; }
+                }
+                if (inside) result.push_back(cell.second.get());
+            }
+            return result;
+        }
+
+        Cell cell = lo;
+        while (true) {
+            auto it = cells.find(cell);
+            if (it != cells.end()) result.push_back(it->second.get());
+
+            // next coords, odometer-like
+            std::size_t i = 0;
+            for (; i < dims; i++) {
+                if (cell[i] < hi[i]) { cell[i]++; break; }
+                cell[i] = lo[i];
+            }
+            if (i == dims) break;
+        }
+        return result;
+    }
+
+public:
+    explicit SyncedChunkedGrid(Scalar cell_size)
+            : cell_size(cell_size) {}
+
+    SyncedChunkedGrid(const SyncedChunkedGrid &) = delete;
+
+    // construct element, and emplace into cell of its position
+    template<class ...Args>
+    trackable_iterator emplace(Args &&...args) {
+        value_type element(std::forward<Args>(args)...);
+        Array &array = get_cell(cell_of(PositionOf{}(element)));
+        return array.emplace(std::move(element))();
+    }
+
+    // Modify element with closure(T&), under chunk lock. If position left cell - move element to the new one.
+    // Return false if element dead.
+    template<class Closure>
+    bool update(const trackable_iterator &iter, Closure &&closure) {
+        auto access = iter.lock();
+        if (!access) return false;
+
+        const Cell from = cell_of(PositionOf{}(*access));
+        closure(*access);
+        const Cell to = cell_of(PositionOf{}(*access));
+        if (from == to) return true;
+
+        find_cell(from)->transfer(iter, get_cell(to));
+        return true;
+    }
+
+    void erase(const trackable_iterator &iter) {
+        auto access = iter.lock();
+        if (!access) return;
+
+        find_cell(cell_of(PositionOf{}(*access)))->erase(iter);
+    }
+
+    // closure(Array::Iterator) for elements inside aabb. Only overlapping cells visited, one by one.
+    // Do not update() from closure - element may be visited twice.
+    template<bool shared = false, class Closure>
+    void iterate_region(const Aabb &aabb, Closure &&closure) {
+        for (Array *array : cells_in(aabb)) {
+            array->template iterate<shared>([&](auto &&iter) {
+                if (aabb.contains(PositionOf{}(*iter))) closure(iter);
+            });
+        }
+    }
+
+    // closure(Array::Iterator) for all elements, cell by cell
+    template<bool shared = false, class Closure>
+    void iterate(Closure &&closure) {
+        std::vector<Array *> arrays;
+        {
+            std::shared_lock<Lock> l(lock);
+            for (auto &cell : cells) arrays.push_back(cell.second.get());
+        }
+        for (Array *array : arrays) array->template iterate<shared>(closure);
+    }
+
+    // cells ever populated
+    std::size_t cells_count() {
+        std::shared_lock<Lock> l(lock);
+        return cells.size();
+    }
+};
@@ -0,0 +1,138 @@
+#pragma once
+
+/// Ordered secondary index over SyncedChunkedArray, by user key projection. Range queries without full scan.
+/// Entries are trackable_iterators - stay valid, when compact/merge relocate elements.
+/// Range iteration locks only chunks holding matches, each once (see SyncedChunkedArray::for_each_tracked).
+
+#include "SyncedChunkedArray.h"
+#include "threading/src/threading/RWSpinLock.h"
+#include <map>
+#include <optional>
+#include <vector>
+#include <mutex>
+#include <shared_mutex>
+#include <type_traits>
+#include <utility>
+
+/// KeyOf - functor, return key of element. Key must not change, while element indexed.
+///
+///     struct PriceOf{ double operator()(const Order &order) const { return order.price; } };
+///     SyncedChunkedIndex<PriceOf, Orders> by_price(orders);
+///     by_price.emplace(42, 10.5);
+///     by_price.iterate_range(10.0, 20.0, [&](auto &&iter){ orders.erase(iter); });
+template<class KeyOf, class Array>
+class SyncedChunkedIndex {
+public:
+    using Key = std::decay_t<decltype(KeyOf{}(std::declval<const typename Array::value_type &>()))>;
+    using trackable_iterator = typename Array::trackable_iterator;
+
+private:
+    Array &array;
+
+    // Not held while emplace into array - never call index from iterate_range closure.
+    using Lock = threading::RWSpinLockWriterBiased<threading::SpinLockMode::Yield>;
+    Lock lock;
+    std::multimap<Key, trackable_iterator> entries;     // node based - trackable_iterators never move
+
+    // remove entries of destroyed elements, among given keys
+    void cleanup(const std::vector<Key> &keys) {
+        if (keys.empty()) return;
+
+        std::vector<trackable_iterator> expired;      // destroy outside of lock
+        std::unique_lock<Lock> l(lock);
+        for (const Key &key : keys) {
+            auto range = entries.equal_range(key);
+            for (auto it = range.first; it != range.second;) {
+                if (it->second.expired()) {
+                    expired.emplace_back(std::move(it->second));
+                    it = entries.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+    }
+
+public:
+    SyncedChunkedIndex(Array &array)
+            : array(array) {}
+
+    SyncedChunkedIndex(const SyncedChunkedIndex &) = delete;
+
+    // emplace into array, and index. Return trackable_iterator.
+    template<class ...Args>
+    trackable_iterator emplace(Args &&...args) {
+        trackable_iterator entry;
+        trackable_iterator iter;
+        {
+            auto result = array.emplace(std::forward<Args>(args)...);
+            entry = result();
+            iter = result();
+        }
+        insert(std::move(entry));
+        return iter;
+    }
+
+    // index element, emplaced directly into array
+    void insert(trackable_iterator &&iter) {
+        // lock order is index -> chunk (see iterate_range), so take key first
+        std::optional<Key> key;
+        {
+            auto access = iter.lock_shared();
+            if (!access) return;
+            key.emplace(KeyOf{}(*access));
+        }
+
+        std::unique_lock<Lock> l(lock);
+        entries.emplace(std::move(*key), std::move(iter));
+    }
+
+    // Erase elements with keys in [lo, hi]. Entries removed lazily (see iterate_range)
+    // Erasing through array directly is fine too.
+    void erase_range(const Key &lo, const Key &hi) {
+        iterate_range(lo, hi, [&](auto &&iter) {
+            array.erase(iter);
+        });
+    }
+
+    // closure(Array::Iterator) for elements with keys in [lo, hi], unordered. Chunks with matches locked one by one,
+    // all matches of chunk visited under one lock. Erased elements skipped.
+    template<bool shared = false, class Closure>
+    void iterate_range(const Key &lo, const Key &hi, Closure &&closure) {
+        std::vector<Key> expired;
+        {
+            std::shared_lock<Lock> l(lock);
+
+            std::vector<const trackable_iterator *> matches;
+            for (auto it = entries.lower_bound(lo); it != entries.end() && !(hi < it->first); ++it) {
+                if (it->second.expired()) {
+                    if (expired.empty() || expired.back() < it->first) expired.push_back(it->first);
+                    continue;
+                }
+                matches.push_back(&it->second);
+            }
+
+            array.template for_each_tracked<shared>(matches, closure);
+        }
+        cleanup(expired);
+    }
+
+    // remove all entries of destroyed elements
+    void cleanup() {
+        std::vector<Key> keys;
+        {
+            std::shared_lock<Lock> l(lock);
+            for (auto &entry : entries) {
+                if (!entry.second.expired() || (!keys.empty() && !(keys.back() < entry.first))) continue;
+                keys.push_back(entry.first);
+            }
+        }
+        cleanup(keys);
+    }
+
+    // entries count, including not yet cleaned up
+    std::size_t size() {
+        std::shared_lock<Lock> l(lock);
+        return entries.size();
+    }
+};
@@ -0,0 +1,162 @@
+#pragma once
+
+/// Join iteration of elements sharing the same key (entity id), across a few SyncedChunkedArrays
+/// Key is dense integer (index in vector), so no hash lookups
+/// Primary container iterated as usual (chunk by chunk), secondary elements reached through shared key index
+/// Secondary chunk kept locked across consecutive keys of one primary chunk (see tracked_cursor) - with elements
+/// emplaced in the same order, secondary chunk locked once per run of keys, not per element.
+/// Deadlock free - secondary chunks only try-locked; busy elements postponed, till all chunk locks released
+
+#include "SyncedChunkedArray.h"
+#include "threading/src/threading/RWSpinLock.h"
+#include <tuple>
+#include <vector>
+#include <optional>
+#include <shared_mutex>
+#include <utility>
+
+/// KeyOf - functor, return std::size_t key of Primary element
+///
+///     struct EntityOf{ std::size_t operator()(const Position &p) const { return p.entity; } };
+///     SyncedChunkedJoin<EntityOf, Positions, Velocities> join(positions, velocities);
+///     join.link(entity, positions.emplace(entity, 0, 0)(), velocities.emplace(1, 1)());
+///     join.iterate([](std::size_t entity, Position &p, Velocity &v){ p.x += v.x; });
+template<class KeyOf, class Primary, class ...Secondary>
+class SyncedChunkedJoin {
+    std::tuple<Primary &, Secondary &...> arrays;
+
+    using Entry = std::tuple<typename Primary::trackable_iterator, typename Secondary::trackable_iterator...>;
+
+    // Entries move only under unique index_lock (index resize) - trackable_iterators follow.
+    // Not held during link/unlink - never call it from iterate closure.
+    using IndexLock = threading::RWSpinLockWriterBiased<threading::SpinLockMode::Yield>;
+    IndexLock index_lock;
+    std::vector<std::optional<Entry>> index;
+
+    Entry *find(std::size_t key) {
+        if (key >= index.size() || !index[key]) return nullptr;
+        return &*index[key];
+    }
+
+    // one per container, each holds its last locked chunk
+    using Cursors = std::tuple<typename Primary::tracked_cursor, typename Secondary::tracked_cursor...>;
+
+    Cursors make_cursors() {
+        return std::apply([](auto &...array) { return Cursors(array...); }, arrays);
+    }
+
+    static void release(Cursors &cursors) {
+        std::apply([](auto &...cursor) { (cursor.release(), ...); }, cursors);
+    }
+
+    enum class Visit { done, busy, expired };
+
+    // reach I..N elements through cursors (try_lock)
+    template<std::size_t I, class Closure, class ...Elements>
+    static Visit visit(Entry &entry, Cursors &cursors, Closure &closure, std::size_t key, Elements *...elements) {
+        if constexpr (I == std::tuple_size<Entry>::value) {
+            closure(key, *elements...);
+            return Visit::done;
+        } else {
+            using Status = typename std::tuple_element_t<I, Cursors>::Status;
+            Status status;
+            auto *element = std::get<I>(cursors).try_get(std::get<I>(entry), status);
+            if (!element) {
+                return status == Status::busy ? Visit::busy : Visit::expired;
+            }
+            return visit<I + 1>(entry, cursors, closure, key, elements..., element);
+        }
+    }
+
+public:
+    SyncedChunkedJoin(Primary &primary, Secondary &...secondary)
+            : arrays(primary, secondary...) {}
+
+    // register elements of one key. Replace previous, if any.
+    void link(std::size_t key, typename Primary::trackable_iterator &&primary,
+              typename Secondary::trackable_iterator &&...secondary) {
+        std::optional<Entry> previous;  // destroy outside of lock
+        std::unique_lock<IndexLock> l(index_lock);
+        if (key >= index.size()) index.resize(key + 1);
+        previous = std::move(index[key]);
+        index[key].emplace(std::move(primary), std::move(secondary)...);
+    }
+
+    void unlink(std::size_t key) {
+        std::optional<Entry> entry;    // destroy outside of lock
+        {
+            std::unique_lock<IndexLock> l(index_lock);
+            if (key >= index.size()) return;
+            entry = std::move(index[key]);
+            index[key].reset();
+        }
+    }
+
+    // erase key elements from all containers
+    void erase(std::size_t key) {
+        std::optional<Entry> entry;
+        {
+            std::unique_lock<IndexLock> l(index_lock);
+            if (key >= index.size()) return;
+            entry = std::move(index[key]);
+            index[key].reset();
+        }
+        if (!entry) return;
+
+        std::apply([&](auto &...array) {
+            std::apply([&](auto &...iter) {
+                (array.erase(iter), ...);
+            }, *entry);
+        }, arrays);
+    }
+
+    // closure(key, Primary element&, Secondary element&...)
+    // Elements without all linked secondaries skipped.
+    template<class Closure>
+    void iterate(Closure &&closure) {
+        std::vector<std::size_t> postponed;
+        Cursors cursors = make_cursors();
+
+        {
+            std::shared_lock<IndexLock> l(index_lock);
+            const void *primary_chunk = nullptr;
+            std::get<0>(arrays).iterate([&](auto &&iter) {
+                // hold secondary chunks only while primary chunk held - iterate may block on next one
+                if (iter.chunk != primary_chunk || Primary::iterate_yields) {
+                    release(cursors);
+                    primary_chunk = iter.chunk;
+                }
+
+                const std::size_t key = KeyOf{}(*iter);
+                Entry *entry = find(key);
+                if (!entry) return;
+
+                if (visit<1>(*entry, cursors, closure, key, &*iter) == Visit::busy) {
+                    postponed.emplace_back(key);
+                }
+            });
+            release(cursors);
+        }
+
+        // no chunk locks held now. Lock primary too.
+        while (!postponed.empty()) {
+            {
+                std::shared_lock<IndexLock> l(index_lock);
+                for (std::size_t i = 0; i < postponed.size();) {
+                    const std::size_t key = postponed[i];
+                    Entry *entry = find(key);
+
+                    if (!entry || visit<0>(*entry, cursors, closure, key) != Visit::busy) {
+                        // unordered remove
+                        postponed[i] = postponed.back();
+                        postponed.pop_back();
+                    } else {
+                        i++;
+                    }
+                }
+                release(cursors);
+            }
+            if (!postponed.empty()) std::this_thread::yield();
+        }
+    }
+};
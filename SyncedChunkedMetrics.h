@@ -0,0 +1,137 @@
+#pragma once
+
+/// Prometheus text exposition of SyncedChunkedArray internals, for many containers at once
+/// Each container exported with `container="<name>"` label
+/// Collection does not lock chunks (see SyncedChunkedArray::metrics()) - scrape as often as you like
+
+#include "SyncedChunkedArray.h"
+#include <string>
+#include <vector>
+#include <functional>
+#include <mutex>
+#include <sstream>
+#include <ostream>
+#include <algorithm>
+
+#if defined(__unix__) || defined(__APPLE__)
+    #include <unistd.h>
+    #include <cerrno>
+#endif
+
+///     SyncedChunkedMetrics metrics;
+///     metrics.add("positions", positions);
+///     metrics.add("velocities", velocities);
+///     std::string text = metrics.scrape();
+class SyncedChunkedMetrics {
+    struct Source {
+        const void *key;
+        std::string labels;
+        std::function<SyncedChunkedArrayMetrics()> collect;
+    };
+
+    std::mutex mutex;
+    std::vector<Source> sources;
+
+    static std::string escape(const std::string &value) {
+        std::string result;
+        for (char c : value) {
+            if (c == '\\')      result += "\\\\";
+            else if (c == '"')  result += "\\\"";
+            else if (c == '\n') result += "\\n";
+            else result += c;
+        }
+        return result;
+    }
+
+    struct Family {
+        const char *name;
+        const char *type;
+        const char *help;
+        double (*get)(const SyncedChunkedArrayMetrics &);
+    };
+
+    static const std::vector<Family> &families() {
+        static const std::vector<Family> families = {
+            {"synced_chunked_array_elements",              "gauge",   "Alive elements.",
+                    [](const SyncedChunkedArrayMetrics &m) { return double(m.elements); }},
+            {"synced_chunked_array_erased_elements",       "gauge",   "Erased, not yet compacted elements.",
+                    [](const SyncedChunkedArrayMetrics &m) { return double(m.erased); }},
+            {"synced_chunked_array_chunks",                "gauge",   "Chunks in container.",
+                    [](const SyncedChunkedArrayMetrics &m) { return double(m.chunks); }},
+            {"synced_chunked_array_capacity",              "gauge",   "Element slots in all chunks.",
+                    [](const SyncedChunkedArrayMetrics &m) { return double(m.capacity); }},
+            {"synced_chunked_array_fill_ratio",            "gauge",   "Alive elements / capacity.",
+                    [](const SyncedChunkedArrayMetrics &m) { return m.fill_ratio(); }},
+            {"synced_chunked_array_free_list_chunks",      "gauge",   "Not full chunks, available for emplace.",
+                    [](const SyncedChunkedArrayMetrics &m) { return double(m.free_list_chunks); }},
+            {"synced_chunked_array_compactions_total",     "counter", "Chunk compactions.",
+                    [](const SyncedChunkedArrayMetrics &m) { return double(m.compactions); }},
+            {"synced_chunked_array_merges_total",          "counter", "Chunk merges.",
+                    [](const SyncedChunkedArrayMetrics &m) { return double(m.merges); }},
+            {"synced_chunked_array_chunks_released_total", "counter", "Chunks deleted or merged into other.",
+                    [](const SyncedChunkedArrayMetrics &m) { return double(m.chunks_released); }},
+            {"synced_chunked_array_lock_contention_total", "counter", "Chunk try_lock failures.",
+                    [](const SyncedChunkedArrayMetrics &m) { return double(m.lock_contention); }},
+        };
+        return families;
+    }
+
+public:
+    // array must outlive registration (see remove())
+    template<class Array>
+    void add(const std::string &name, Array &array) {
+        std::unique_lock<std::mutex> l(mutex);
+        sources.push_back({&array, "container=\"" + escape(name) + "\"", [&array]() { return array.metrics(); }});
+    }
+
+    template<class Array>
+    void remove(const Array &array) {
+        std::unique_lock<std::mutex> l(mutex);
+        sources.erase(std::remove_if(sources.begin(), sources.end(), [&](const Source &source) {
+            return source.key == &array;
+        }), sources.end());
+    }
+
+    void write(std::ostream &out) {
+        std::vector<std::pair<std::string, SyncedChunkedArrayMetrics>> collected;
+        {
+            std::unique_lock<std::mutex> l(mutex);
+            collected.reserve(sources.size());
+            for (Source &source : sources) collected.emplace_back(source.labels, source.collect());
+        }
+
+        // counters printed exactly, up to 2^53
+        const std::streamsize precision = out.precision(17);
+        for (const Family &family : families()) {
+            out << "# HELP " << family.name << " " << family.help << "\n";
+            out << "# TYPE " << family.name << " " << family.type << "\n";
+            for (const auto &item : collected) {
+                out << family.name << "{" << item.first << "} " << family.get(item.second) << "\n";
+            }
+        }
+        out.precision(precision);
+    }
+
+    std::string scrape() {
+        std::ostringstream out;
+        write(out);
+        return out.str();
+    }
+
+#if defined(__unix__) || defined(__APPLE__)
+    // return false on write error
+    bool write(int fd) {
+        const std::string text = scrape();
+        std::size_t written = 0;
+        while (written < text.size()) {
+            const ssize_t result = ::write(fd, text.data() + written, text.size() - written);
+            if (result < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            written += std::size_t(result);
+        }
+        return true;
+    }
+#endif
+};
@@ -0,0 +1,80 @@
+#pragma once
+
+/// Heterogeneous container of Base descendants
+/// Each Derived stored by value, in its own SyncedChunkedArray
+/// Iteration goes type by type - no pointer chasing, virtual calls can be devirtualized
+/// (mark Derived final, or use qualified calls)
+/// Same locking / trackable_iterator guarantees as SyncedChunkedArray
+
+#include "SyncedChunkedArray.h"
+#include <tuple>
+#include <type_traits>
+
+template<class Base, class ...Derived>
+class SyncedChunkedPoly {
+    static_assert((std::is_base_of<Base, Derived>::value && ...), "Derived must be derived from Base");
+
+    template<class D, class ...List>
+    static constexpr const bool contains = (std::is_same<D, List>::value || ...);
+
+    template<class D>
+    using Array = SyncedChunkedArray<D>;
+
+    std::tuple<Array<Derived>...> arrays;
+
+public:
+    template<class D>
+    using Iterator = typename Array<D>::Iterator;
+
+    template<class D>
+    using trackable_iterator = typename Array<D>::trackable_iterator;
+
+    template<class D>
+    Array<D> &array() {
+        static_assert(contains<D, Derived...>, "D is not in Derived list");
+        return std::get<Array<D>>(arrays);
+    }
+
+    template<class D, class ...Args>
+    auto emplace(Args &&...args) {
+        return array<D>().emplace(std::forward<Args>(args)...);
+    }
+
+    // D can't be deduced - use erase<D>(iter)
+    template<class D>
+    void erase(const Iterator<D> &iter) {
+        array<D>().erase(iter);
+    }
+
+    template<class D>
+    void erase(const trackable_iterator<D> &iter) {
+        array<D>().erase(iter);
+    }
+
+    // closure called with Iterator<D>, for each D from Derived. Use generic lambda:
+    //     poly.iterate([](auto &&iter){ (*iter).update(); });
+    // or overloaded closure.
+    template<bool shared = false, class Closure>
+    void iterate(Closure &&closure) {
+        std::apply([&](auto &...array) {
+            (array.template iterate<shared>(closure), ...);
+        }, arrays);
+    }
+
+    template<class Closure>
+    void iterate_shared(Closure &&closure) {
+        iterate<true>(std::forward<Closure>(closure));
+    }
+
+    // iterate only one type
+    template<class D, bool shared = false, class Closure>
+    void iterate_type(Closure &&closure) {
+        array<D>().template iterate<shared>(std::forward<Closure>(closure));
+    }
+
+    std::size_t get_chunks_count() {
+        return std::apply([](auto &...array) {
+            return (std::size_t(0) + ... + array.get_chunks_count());
+        }, arrays);
+    }
+};
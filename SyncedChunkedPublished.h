@@ -0,0 +1,46 @@
+#pragma once
+
+/// Double-buffered SyncedChunkedArray
+/// Builder fill next generation offline, then publish() it
+/// Readers take published_view() - never see partial rebuilds, and iterate it without chunk locks
+/// Old generation destroyed when last reader leave it
+
+#include "SyncedChunkedArray.h"
+#include <memory>
+
+template<class Array>
+class SyncedChunkedPublished {
+    // atomic_shared_ptr
+    std::shared_ptr<const Array> published{std::make_shared<const Array>()};
+
+public:
+    class View {
+        friend SyncedChunkedPublished;
+
+        std::shared_ptr<const Array> array;
+
+        View(std::shared_ptr<const Array> array)
+                : array(std::move(array)) {}
+
+    public:
+        // closure(const Iterator&). Lock-free.
+        template<class Closure>
+        void iterate(Closure &&closure) const {
+            array->iterate_unsynced(std::forward<Closure>(closure));
+        }
+
+        const Array &get() const {
+            return *array;
+        }
+    };
+
+    // Readers. Generation stay alive, while View alive.
+    View published_view() const {
+        return {std::atomic_load(&published)};
+    }
+
+    // Builder. `next` must be not used by anyone else. Previous generation destroyed, when last View leave it.
+    void publish(Array &&next) {
+        std::atomic_store(&published, std::shared_ptr<const Array>(std::make_shared<Array>(std::move(next))));
+    }
+};
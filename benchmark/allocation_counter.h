@@ -0,0 +1,71 @@
+#pragma once
+
+// Counting global operator new/delete. Include in one translation unit only.
+// Enabled with BENCHMARK_COUNT_ALLOCATIONS define (cmake -DBENCHMARK_COUNT_ALLOCATIONS=ON).
+
+#include <atomic>
+#include <cstdlib>
+#include <cstddef>
+#include <new>
+
+struct AllocationCounter {
+    struct Snapshot {
+        std::size_t allocations;
+        std::size_t bytes;
+    };
+
+    static std::atomic<std::size_t> &allocations() {
+        static std::atomic<std::size_t> value{0};
+        return value;
+    }
+
+    static std::atomic<std::size_t> &bytes() {
+        static std::atomic<std::size_t> value{0};
+        return value;
+    }
+
+    static Snapshot snapshot() {
+        return {allocations().load(), bytes().load()};
+    }
+
+    static void count(std::size_t size) {
+        allocations().fetch_add(1, std::memory_order_relaxed);
+        bytes().fetch_add(size, std::memory_order_relaxed);
+    }
+};
+
+#ifdef BENCHMARK_COUNT_ALLOCATIONS
+
+namespace allocation_counter_details {
+    inline void *allocate(std::size_t size) {
+        AllocationCounter::count(size);
+        if (size == 0) size = 1;
+        if (void *ptr = std::malloc(size)) return ptr;
+        throw std::bad_alloc();
+    }
+
+    inline void *allocate(std::size_t size, std::align_val_t align) {
+        AllocationCounter::count(size);
+        const std::size_t alignment = static_cast<std::size_t>(align);
+        size = (size + alignment - 1) / alignment * alignment;      // aligned_alloc requirement
+        if (size == 0) size = alignment;
+        if (void *ptr = std::aligned_alloc(alignment, size)) return ptr;
+        throw std::bad_alloc();
+    }
+}
+
+void *operator new(std::size_t size) { return allocation_counter_details::allocate(size); }
+void *operator new[](std::size_t size) { return allocation_counter_details::allocate(size); }
+void *operator new(std::size_t size, std::align_val_t align) { return allocation_counter_details::allocate(size, align); }
+void *operator new[](std::size_t size, std::align_val_t align) { return allocation_counter_details::allocate(size, align); }
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
+
+#endif
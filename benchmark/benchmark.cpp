@@ -19,6 +19,8 @@
 #include <thread>
 #include <deque>
 #include "../SyncedChunkedArray.h"
+#include "perf_counters.h"
+#include "allocation_counter.h"
 
 template<class time_unit = std::chrono::milliseconds, class Closure>
 auto measure(Closure&& closure){
@@ -31,6 +33,19 @@ auto measure(Closure&& closure){
 }
 
 
+// same as measure, plus hardware counters per element report (cmake -DBENCHMARK_PERF_COUNTERS=ON)
+template<class time_unit = std::chrono::milliseconds, class Closure>
+auto measure(const char* name, std::size_t elements, Closure&& closure){
+    PerfCounters counters;
+    counters.start();
+    auto t = measure<time_unit>(std::forward<Closure>(closure));
+    counters.stop();
+
+    counters.report(name, elements);
+    return t;
+}
+
+
 template<class time_unit = std::chrono::milliseconds, class Closure>
 auto benchmark(int times, Closure&& closure){
     return measure<time_unit>([&](){
@@ -58,7 +73,7 @@ void benchmark_iterate(int times) {
     std::vector<BigData> vec;
 
     {
-        auto t = measure([&]() {
+        auto t = measure("vec insert", size, [&]() {
             for (int i = 0; i < size; i++)
                 vec.emplace_back(i);
         });
@@ -67,7 +82,7 @@ void benchmark_iterate(int times) {
     }
 
     {
-        auto t = measure([&]() {
+        auto t = measure("arr insert", size, [&]() {
             for (int i = 0; i < size; i++)
                 arr.emplace(i);
         });
@@ -79,7 +94,7 @@ void benchmark_iterate(int times) {
     {
         const float erase_probability = 0;        // 50 - worst case
         const int break_point = std::round(RAND_MAX * erase_probability / 100.0);
-        auto t = measure([&]() {
+        auto t = measure("arr erase", size, [&]() {
             std::size_t i = 0;
             arr.iterate([&](auto &&iter) {
                 const int random_variable = std::rand();
@@ -96,15 +111,23 @@ void benchmark_iterate(int times) {
         std::cout << "Erased in: " << t << std::endl;
     }
 
-    auto benchmark_threaded_read = [&](auto times, auto&& closure) -> std::size_t {
+    // elements - per one closure run
+    auto benchmark_threaded_read = [&](const char* name, std::size_t elements, auto times, auto&& closure) -> std::size_t {
         std::array<std::thread, threads_count> threads;
 
         std::atomic<std::size_t> total{0};
 
+        PerfCounters counters;
+        counters.start();
+
         if (threads_count == 0){
-            return benchmark(times, [&]() {
+            auto t = benchmark(times, [&]() {
                 closure();
             });
+
+            counters.stop();
+            counters.report(name, elements * times);
+            return t;
         }
         for (int i = 0; i < threads_count; i++) {
             threads[i] = std::thread([&](){
@@ -116,6 +139,9 @@ void benchmark_iterate(int times) {
         }
         for (auto &thread : threads) thread.join();
 
+        counters.stop();
+        counters.report(name, elements * times * threads_count);
+
         return total.load();
     };
 
@@ -124,7 +150,7 @@ void benchmark_iterate(int times) {
         std::atomic<std::size_t> sum{0};
         std::atomic<std::size_t> iterate_count{0};
 
-        auto t = benchmark_threaded_read(times, [&]() {
+        auto t = benchmark_threaded_read("vec iterate", vec.size(), times, [&]() {
             std::size_t local_sum{0};
             std::size_t local_iterate_count{0};
 
@@ -144,7 +170,7 @@ void benchmark_iterate(int times) {
     {
         std::atomic<std::size_t> sum{0};
         std::atomic<std::size_t> iterate_count{0};
-        auto t = benchmark_threaded_read(times, [&]() {
+        auto t = benchmark_threaded_read("arr iterate", vec.size(), times, [&]() {
             std::size_t local_sum{0};
             std::size_t local_iterate_count{0};
 
@@ -163,7 +189,84 @@ void benchmark_iterate(int times) {
 
 }
 
+// return false, if expect_zero and closure allocates
+template<class Closure>
+bool count_allocations(const char* name, std::size_t operations, bool expect_zero, Closure&& closure){
+    const auto before = AllocationCounter::snapshot();
+    closure();
+    const auto after = AllocationCounter::snapshot();
+
+    const std::size_t allocations = after.allocations - before.allocations;
+    const std::size_t bytes = after.bytes - before.bytes;
+    const bool ok = !expect_zero || allocations == 0;
+
+    std::cout << name << ": " << double(allocations) / operations << " allocations/op, "
+              << double(bytes) / operations << " bytes/op"
+              << (expect_zero ? (ok ? " [zero: ok]" : " [zero: FAIL]") : "") << std::endl;
+    return ok;
+}
+
+// allocations per operation. Steady state operations must not allocate.
+bool benchmark_allocations(){
+    const int size = 10000;
+    using Array = SyncedChunkedArray<BigData>;
+    Array arr;
+    bool ok = true;
+
+    count_allocations("emplace", size, false, [&]() {
+        for (int i = 0; i < size; i++)
+            arr.emplace(i);
+    });
+
+    ok &= count_allocations("erase", size / 2, true, [&]() {
+        arr.iterate([&](auto &&iter) {
+            if ((*iter).value % 2 == 0) arr.erase(iter);
+        });
+    });
+
+    ok &= count_allocations("iterate", size / 2, true, [&]() {
+        std::size_t sum = 0;
+        arr.iterate([&](auto &&iter) { sum += (*iter).value; });
+    });
+
+    ok &= count_allocations("emplace (steady, reuse free chunks)", size / 2, true, [&]() {
+        for (int i = 0; i < size / 2; i++)
+            arr.emplace(i * 2);
+    });
+
+    std::vector<Array::trackable_iterator> tracked;
+    tracked.reserve(size);
+    ok &= count_allocations("trackable_iterator construct", size, true, [&]() {
+        arr.iterate([&](auto &&iter) { tracked.emplace_back(iter); });
+    });
+
+    std::vector<Array::trackable_iterator> moved(size);
+    ok &= count_allocations("trackable_iterator move", size, true, [&]() {
+        for (std::size_t i = 0; i < tracked.size(); i++) moved[i] = std::move(tracked[i]);
+    });
+
+    ok &= count_allocations("trackable_iterator lock", size, true, [&]() {
+        for (auto &iter : moved) {
+            auto access = iter.lock();
+        }
+    });
+
+    Array target;
+    ok &= count_allocations("container move", 1, false, [&]() {
+        target = std::move(arr);
+    });
+
+    return ok;
+}
+
 int main(){
     std::cout << "-= iteration benchmark =-" << std::endl;
     benchmark_iterate(1000);
+
+#ifdef BENCHMARK_COUNT_ALLOCATIONS
+    std::cout << "-= allocations benchmark =-" << std::endl;
+    if (!benchmark_allocations()) return 1;
+#endif
+
+    return 0;
 }
\ No newline at end of file
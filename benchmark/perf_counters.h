@@ -0,0 +1,120 @@
+#pragma once
+
+// Hardware performance counters (Linux perf_event_open), to see why something is faster/slower.
+// Enabled with BENCHMARK_PERF_COUNTERS define (cmake -DBENCHMARK_PERF_COUNTERS=ON).
+// Counters, which can't be opened (no PMU, VM, perf_event_paranoid, other OS) silently skipped.
+
+#include <array>
+#include <cstdint>
+#include <iostream>
+#include <iomanip>
+#include <string>
+
+#if defined(BENCHMARK_PERF_COUNTERS) && defined(__linux__)
+    #include <linux/perf_event.h>
+    #include <sys/ioctl.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+    #define BENCHMARK_PERF_COUNTERS_ENABLED
+#endif
+
+class PerfCounters {
+public:
+    static constexpr const std::size_t count = 6;
+
+private:
+    struct Event {
+        const char *name;
+        std::uint32_t type;
+        std::uint64_t config;
+    };
+
+    static std::array<Event, count> events() {
+    #ifdef BENCHMARK_PERF_COUNTERS_ENABLED
+        auto cache = [](std::uint64_t cache, std::uint64_t op, std::uint64_t result) {
+            return cache | (op << 8) | (result << 16);
+        };
+        return {{
+            {"cycles",       PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {"L1D-misses",   PERF_TYPE_HW_CACHE, cache(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS)},
+            {"LLC-misses",   PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+            {"dTLB-misses",  PERF_TYPE_HW_CACHE, cache(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS)},
+            {"branch-misses",PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+        }};
+    #else
+        return {};
+    #endif
+    }
+
+    std::array<int, count> fds;
+    std::array<std::uint64_t, count> values{};
+
+public:
+    PerfCounters() {
+        fds.fill(-1);
+    #ifdef BENCHMARK_PERF_COUNTERS_ENABLED
+        const auto events = PerfCounters::events();
+        for (std::size_t i = 0; i < count; i++) {
+            perf_event_attr attr{};
+            attr.size = sizeof(attr);
+            attr.type = events[i].type;
+            attr.config = events[i].config;
+            attr.disabled = 1;
+            attr.inherit = 1;           // count threads, spawned inside scenario too
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+
+            fds[i] = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+        }
+    #endif
+    }
+
+    PerfCounters(const PerfCounters &) = delete;
+
+    ~PerfCounters() {
+    #ifdef BENCHMARK_PERF_COUNTERS_ENABLED
+        for (int fd : fds) if (fd != -1) close(fd);
+    #endif
+    }
+
+    bool available() const {
+        for (int fd : fds) if (fd != -1) return true;
+        return false;
+    }
+
+    void start() {
+    #ifdef BENCHMARK_PERF_COUNTERS_ENABLED
+        for (int fd : fds) {
+            if (fd == -1) continue;
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    #endif
+    }
+
+    void stop() {
+    #ifdef BENCHMARK_PERF_COUNTERS_ENABLED
+        for (std::size_t i = 0; i < count; i++) {
+            values[i] = 0;
+            if (fds[i] == -1) continue;
+            ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+            if (read(fds[i], &values[i], sizeof(values[i])) != sizeof(values[i])) values[i] = 0;
+        }
+    #endif
+    }
+
+    // per element rates
+    void report(const std::string &name, std::size_t elements) const {
+        if (!available() || elements == 0) return;
+
+        const auto events = PerfCounters::events();
+        std::cout << "  [" << name << " per element]";
+        for (std::size_t i = 0; i < count; i++) {
+            if (fds[i] == -1) continue;
+            std::cout << " " << events[i].name << ": " << std::fixed << std::setprecision(3)
+                      << double(values[i]) / elements;
+        }
+        std::cout << std::defaultfloat << std::endl;
+    }
+};
@@ -1,9 +1,25 @@
 #include <iostream>
+#include <cstdlib>
+#include <string>
 #include "../SyncedChunkedArray.h"
+#include "../SyncedChunkedPoly.h"
+#include "../SyncedChunkedJoin.h"
+#include "../SyncedChunkedPublished.h"
+#include "../SyncedChunkedMetrics.h"
+#include "../SyncedChunkedIndex.h"
+#include "../SyncedChunkedGrid.h"
 //#include "../v2/SyncedChunkedArray.h"
 
 #include "reuse_test.h"
 
+// series tests print "actual (expected)" and check() it - main() returns non-zero if any mismatched
+bool tests_failed = false;
+void check(bool ok, const char *what) {
+    if (ok) return;
+    tests_failed = true;
+    std::cout << "FAILED: " << what << std::endl;
+}
+
 
 void test_trackable_iterator_erase(){
     SyncedChunkedArray<int, 4> list;
@@ -80,14 +96,920 @@ void test_trackable_iterator_move(){
 
 }
 
+// element keeps its address in external index
+struct RelocationTracked {
+    int value;
+    std::vector<RelocationTracked*> *index;
+
+    RelocationTracked(int value, std::vector<RelocationTracked*> *index)
+        : value(value), index(index) {}
+};
+
+struct RelocationPolicy : SyncedChunkedArrayPolicy {
+    template<class T, class Iterator>
+    static void on_relocate(T &element, const Iterator &, const Iterator &) {
+        (*element.index)[element.value] = &element;
+    }
+
+    template<class T, class Iterator>
+    static void on_destroy(T &element, const Iterator &) {
+        (*element.index)[element.value] = nullptr;
+    }
+};
+
+void test_relocation_hook(){
+    using List = SyncedChunkedArray<RelocationTracked, 4, RelocationPolicy>;
+    std::vector<RelocationTracked*> index(40, nullptr);
+    {
+        List list;
+
+        for (int i = 0; i < 40; i++) list.emplace(i, &index);
+        list.iterate([&](auto &&iter) {
+            index[(*iter).value] = &*iter;
+        });
+
+        // erase every second, and most of the tail - will cause compact and merge
+        list.iterate([&](auto &&iter) {
+            if ((*iter).value % 2 == 0 || (*iter).value > 30) list.erase(iter);
+        });
+        list.iterate([&](auto &&) {});
+
+        bool ok = true;
+        for (int i = 0; i < 40; i++) {
+            const bool alive = (i % 2 != 0 && i <= 30);
+            if (alive) {
+                ok = ok && index[i] && index[i]->value == i;
+            } else {
+                ok = ok && !index[i];
+            }
+        }
+        std::cout << "relocation index " << (ok ? "ok" : "broken") << std::endl;
+        check(ok, "relocation index");
+    }
+
+    bool all_destroyed = true;
+    for (auto *ptr : index) all_destroyed = all_destroyed && !ptr;
+    std::cout << "destroy hooks " << (all_destroyed ? "ok" : "broken") << std::endl;
+    check(all_destroyed, "destroy hooks");
+}
+
+struct TtlPolicy : SyncedChunkedArrayPolicy {
+    static constexpr const bool ttl = true;
+};
+
+void test_expire(){
+    using List = SyncedChunkedArray<int, 4, TtlPolicy>;
+    using time_point = List::time_point;
+    using duration = List::clock::duration;
+    List list;
+
+    for (int i = 0; i < 100; i++) list.emplace_until(time_point(duration(i)), i);
+    for (int i = 0; i < 10; i++) list.emplace(-1);      // never expires
+
+    List::trackable_iterator prolonged = list.emplace_until(time_point(duration(10)), 1000)();
+    list.set_expiry(prolonged, time_point(duration(1000)));
+
+    const std::size_t expired = list.expire(time_point(duration(50)));
+
+    std::size_t count = 0;
+    bool ok = true;
+    list.iterate([&](auto &&iter) {
+        ok = ok && (*iter == -1 || *iter > 50);
+        count++;
+    });
+    std::cout << "expired " << expired << " (51), left " << count << " (60) " << (ok ? "ok" : "broken") << std::endl;
+    check(expired == 51 && count == 60 && ok, "expire");
+    const int prolonged_value = *prolonged.lock();
+    std::cout << "prolonged " << prolonged_value << " (1000)" << std::endl;
+    check(prolonged_value == 1000, "set_expiry");
+}
+
+struct Message {
+    std::vector<char> buffer;
+
+    void reset() { buffer.clear(); }     // keep capacity
+};
+
+struct RecyclePolicy : SyncedChunkedArrayPolicy {
+    static constexpr const bool recycle = true;
+};
+
+void test_recycle(){
+    using List = SyncedChunkedArray<Message, 4, RecyclePolicy>;
+    List list;
+
+    for (int i = 0; i < 16; i++) {
+        list.emplace_recycled([](Message &message) {
+            message.buffer.assign(1000, 'a');
+        });
+    }
+
+    // erase all, but first chunk (is_first) survives - and keep erased elements as recycled
+    list.iterate([&](auto &&iter) { list.erase(iter); });
+    list.iterate([&](auto &&) {});
+
+    std::size_t reused = 0;
+    for (int i = 0; i < 4; i++) {
+        list.emplace_recycled([&](Message &message) {
+            if (message.buffer.empty() && message.buffer.capacity() >= 1000) reused++;
+            message.buffer.assign(10, 'b');
+        });
+    }
+
+    std::size_t count = 0;
+    list.iterate([&](auto &&iter) {
+        if ((*iter).buffer.size() == 10) count++;
+    });
+    std::cout << "recycled " << reused << " (4), alive " << count << " (4)" << std::endl;
+    check(reused == 4 && count == 4, "recycle");
+}
+
+struct Shape {
+    virtual double area() const = 0;
+    virtual ~Shape() = default;
+};
+struct Square final : Shape {
+    double side;
+    Square(double side) : side(side) {}
+    double area() const override { return side * side; }
+};
+struct Rect final : Shape {
+    double w, h;
+    Rect(double w, double h) : w(w), h(h) {}
+    double area() const override { return w * h; }
+};
+
+void test_poly(){
+    using Shapes = SyncedChunkedPoly<Shape, Square, Rect>;
+    Shapes shapes;
+
+    for (int i = 0; i < 100; i++) {
+        shapes.emplace<Square>(2);
+        shapes.emplace<Rect>(1, 3);
+    }
+    Shapes::trackable_iterator<Rect> rect = shapes.emplace<Rect>(10, 10)();
+
+    double area = 0;
+    shapes.iterate_shared([&](auto &&iter) {
+        area += (*iter).area();
+    });
+    std::cout << "poly area " << area << " (800)" << std::endl;
+    check(area == 800, "poly area");
+
+    shapes.erase<Rect>(rect);
+    area = 0;
+    shapes.iterate_type<Rect>([&](auto &&iter) {
+        area += (*iter).area();
+    });
+    std::cout << "rect area " << area << " (300)" << std::endl;
+    check(area == 300, "rect area");
+}
+
+struct Position {
+    std::size_t entity;
+    int x;
+    Position(std::size_t entity, int x) : entity(entity), x(x) {}
+};
+struct Velocity {
+    int dx;
+    Velocity(int dx) : dx(dx) {}
+};
+struct EntityOf {
+    std::size_t operator()(const Position &position) const { return position.entity; }
+};
+
+void test_join(){
+    using Positions  = SyncedChunkedArray<Position, 8>;
+    using Velocities = SyncedChunkedArray<Velocity, 8>;
+    Positions positions;
+    Velocities velocities;
+
+    SyncedChunkedJoin<EntityOf, Positions, Velocities> join(positions, velocities);
+
+    const std::size_t count = 1000;
+    for (std::size_t entity = 0; entity < count; entity++) {
+        auto position = positions.emplace(entity, 0)();
+        if (entity % 2 == 0) {
+            join.link(entity, std::move(position), velocities.emplace(int(entity))());
+        }
+    }
+
+    auto fn = [&]() {
+        join.iterate([](std::size_t, Position &position, Velocity &velocity) {
+            position.x += velocity.dx;
+        });
+    };
+    std::thread t1(fn);
+    std::thread t2(fn);
+    t1.join();
+    t2.join();
+
+    join.erase(0);
+    join.erase(2);
+
+    bool ok = true;
+    positions.iterate([&](auto &&iter) {
+        const Position &position = *iter;
+        const int expected = position.entity % 2 == 0 ? 2 * int(position.entity) : 0;
+        ok = ok && position.x == expected && position.entity != 0 && position.entity != 2;
+    });
+    std::cout << "join " << (ok ? "ok" : "broken") << std::endl;
+    check(ok, "join");
+}
+
+void test_for_each_tracked(){
+    using List = SyncedChunkedArray<int, 8>;
+    List list;
+
+    std::vector<List::trackable_iterator> tracked;
+    for (int i = 0; i < 1000; i++) {
+        auto iter = list.emplace(i)();
+        if (i % 3 == 0) tracked.emplace_back(std::move(iter));
+    }
+
+    // erase untracked - elements will move
+    list.iterate([&](auto &&iter) {
+        if (*iter % 3 != 0) list.erase(iter);
+    });
+
+    auto fn = [&]() {
+        list.for_each_tracked(tracked, [](auto &&iter) {
+            *iter += 1000;
+        });
+    };
+    std::thread t1(fn);
+    std::thread t2(fn);
+    t1.join();
+    t2.join();
+
+    bool ok = true;
+    for (int i = 0; i < int(tracked.size()); i++) {
+        ok = ok && *tracked[i].lock() == i * 3 + 2000;
+    }
+    std::cout << "for_each_tracked " << (ok ? "ok" : "broken") << std::endl;
+    check(ok, "for_each_tracked");
+}
+
+void test_budget(){
+    using List = SyncedChunkedArray<int, 4>;
+    List list;
+    list.set_elements_budget(8);
+
+    std::size_t high_water = 0;
+    list.set_high_water_mark(2, [&](std::size_t chunks) { high_water = chunks; });
+
+    std::size_t emplaced = 0;
+    for (int i = 0; i < 10; i++) {
+        if (list.try_emplace(i)) emplaced++;
+    }
+    std::cout << "budget emplaced " << emplaced << " (8), high water " << high_water << " (2)" << std::endl;
+    check(emplaced == 8 && high_water == 2, "budget");
+
+    std::atomic<bool> done{false};
+    std::thread waiter([&]() {
+        list.emplace_wait(100);
+        done = true;
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    const bool blocked = !done;
+
+    list.iterate([&](auto &&iter) {
+        if (*iter < 2) list.erase(iter);
+    });
+    list.iterate([&](auto &&) {});     // maintain
+    waiter.join();
+
+    std::cout << "emplace_wait " << (blocked && done ? "ok" : "broken") << std::endl;
+    check(blocked && done, "emplace_wait");
+
+    // raised budget wakes waiter too (no polling - would hang otherwise)
+    while (list.try_emplace(0)) {}
+    std::atomic<bool> raised_done{false};
+    std::thread raised_waiter([&]() {
+        list.emplace_wait(200);
+        raised_done = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    const bool raised_blocked = !raised_done;
+    list.set_elements_budget(16);
+    raised_waiter.join();
+
+    std::cout << "emplace_wait on budget raise " << (raised_blocked && raised_done ? "ok" : "broken") << std::endl;
+    check(raised_blocked && raised_done, "emplace_wait on budget raise");
+
+    // space freed in head chunk (it never goes to free list) wakes waiter too
+    List head;
+    head.set_elements_budget(4);
+    for (int i = 0; i < 4; i++) head.emplace(i);
+    std::atomic<bool> head_done{false};
+    std::thread head_waiter([&]() {
+        head.emplace_wait(100);
+        head_done = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    const bool head_blocked = !head_done;
+    head.iterate([&](auto &&iter) {
+        if (*iter < 2) head.erase(iter);
+    });
+    head.iterate([](auto &&) {});     // maintain
+    head_waiter.join();
+
+    std::cout << "emplace_wait on head chunk " << (head_blocked && head_done ? "ok" : "broken") << std::endl;
+    check(head_blocked && head_done, "emplace_wait on head chunk");
+}
+
+struct PoolPolicy : SyncedChunkedArrayPolicy {
+    static constexpr const std::size_t chunk_pool_capacity = 4;
+};
+
+void test_chunk_pool(){
+    using List = SyncedChunkedArray<int, 4, PoolPolicy>;
+    List list;
+
+    for (int i = 0; i < 40; i++) list.emplace(i);
+    list.iterate([&](auto &&iter) { list.erase(iter); });
+    list.iterate([&](auto &&) {});
+
+    const std::size_t pooled = list.get_pooled_chunks_count();
+    const std::size_t trimmed = list.trim();
+    const std::size_t trimmed_again = list.trim();
+
+    for (int i = 0; i < 40; i++) list.emplace(i);
+    std::size_t sum = 0;
+    list.iterate([&](auto &&iter) { sum += *iter; });
+
+    std::cout << "pooled " << pooled << " (4), trimmed " << trimmed << " (4), again " << trimmed_again << " (0)"
+              << ", reused pool " << list.get_pooled_chunks_count() << " (0), sum " << sum << " (780)" << std::endl;
+    check(pooled == 4 && trimmed == 4 && trimmed_again == 0
+          && list.get_pooled_chunks_count() == 0 && sum == 780, "chunk pool");
+}
+
+struct DeferredTeardownPolicy : SyncedChunkedArrayPolicy {
+    static constexpr const bool deferred_teardown = true;
+};
+
+void test_deferred_teardown(){
+    using List = SyncedChunkedArray<int, 4, DeferredTeardownPolicy>;
+    auto *list = new List;
+    for (int i = 0; i < 100; i++) list->emplace(i);
+    List::trackable_iterator iter = list->emplace(-1)();
+
+    std::atomic<bool> locked{false};
+    std::atomic<bool> release{false};
+    std::thread holder([&]() {
+        auto access = iter.lock();
+        locked = true;
+        while (!release) std::this_thread::yield();
+    });
+    while (!locked) std::this_thread::yield();
+
+    delete list;        // must not wait for holder
+    release = true;
+    holder.join();
+
+    // wait for reclaimer
+    for (int i = 0; i < 1000 && !iter.expired(); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    std::cout << "deferred teardown " << (iter.expired() ? "ok" : "broken") << std::endl;
+    check(iter.expired(), "deferred teardown");
+}
+
+// static container may outlive reclaimer - torn down inline then
+void test_deferred_teardown_static(){
+    static std::atomic<int> destroyed{0};
+    struct Element {
+        ~Element() { destroyed++; }
+    };
+    struct Checker {
+        ~Checker() {
+            // reclaimer may still be running, if it was created before container
+            for (int i = 0; i < 1000 && destroyed < 100; i++) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            std::cout << "static deferred teardown, destroyed at exit " << destroyed << " (100)" << std::endl;
+            // main() already returned
+            if (destroyed != 100) {
+                std::cout << "FAILED: static deferred teardown" << std::endl;
+                std::_Exit(1);
+            }
+        }
+    };
+    static Checker checker;
+
+    using List = SyncedChunkedArray<Element, 4, DeferredTeardownPolicy>;
+    static List list;
+    for (int i = 0; i < 100; i++) list.emplace();
+    destroyed = 0;
+
+    // first use of reclaimer, after list - it will be drained before list destroyed
+    SyncedChunkedArrayReclaimer::instance();
+}
+
+void test_swap(){
+    using List = SyncedChunkedArray<int, 4>;
+    List current;
+    for (int i = 0; i < 100; i++) current.emplace(1);
+
+    List::trackable_iterator tracked = current.emplace(1000)();
+
+    std::atomic<bool> stop{false};
+    std::thread reader([&]() {
+        while (!stop) {
+            auto access = tracked.lock();
+        }
+    });
+
+    for (int generation = 0; generation < 100; generation++) {
+        List next;
+        for (int i = 0; i < 100; i++) next.emplace(generation);
+        current.swap(next);
+    }
+    List moved(std::move(current));
+    current = std::move(moved);
+
+    stop = true;
+    reader.join();
+
+    std::size_t count = 0;
+    current.iterate([&](auto &&iter) { if (*iter == 99) count++; });
+    std::cout << "swap " << count << " (100), tracked expired " << tracked.expired() << " (1)" << std::endl;
+    check(count == 100 && tracked.expired(), "swap");
+}
+
+void test_published(){
+    using List = SyncedChunkedArray<int, 16>;
+    SyncedChunkedPublished<List> table;
+
+    // each generation - 1000 elements with the same value
+    std::atomic<bool> stop{false};
+    std::atomic<bool> partial{false};
+    auto reader = [&]() {
+        while (!stop) {
+            auto view = table.published_view();
+            std::size_t count = 0;
+            int value = -1;
+            view.iterate([&](const auto &iter) {
+                if (value != -1 && *iter != value) partial = true;
+                value = *iter;
+                count++;
+            });
+            if (count != 0 && count != 1000) partial = true;
+        }
+    };
+    std::thread t1(reader);
+    std::thread t2(reader);
+
+    for (int generation = 0; generation < 100; generation++) {
+        List next;
+        for (int i = 0; i < 1000; i++) next.emplace(generation);
+        table.publish(std::move(next));
+    }
+
+    stop = true;
+    t1.join();
+    t2.join();
+    std::cout << "published " << (partial ? "broken" : "ok") << std::endl;
+    check(!partial, "published");
+}
+
+void test_metrics(){
+    SyncedChunkedArray<int, 16> positions;
+    SyncedChunkedArray<int, 16> velocities;
+
+    for (int i = 0; i < 100; i++) positions.emplace(i);
+    for (int i = 0; i < 10; i++) velocities.emplace(i);
+
+    positions.iterate([&](auto &&iter) {
+        if (*iter % 2 == 0) positions.erase(iter);
+    });
+
+    SyncedChunkedMetrics metrics;
+    metrics.add("positions", positions);
+    metrics.add("velocities", velocities);
+
+    const auto m = positions.metrics();
+    std::cout << "elements " << m.elements << " (50) chunks " << m.chunks << " compactions " << m.compactions << std::endl;
+    check(m.elements == 50, "metrics elements");
+
+    const std::string scrape = metrics.scrape();
+    std::cout << scrape;
+    check(scrape.find("\"positions\"") != std::string::npos
+          && scrape.find("\"velocities\"") != std::string::npos, "metrics scrape");
+}
+
+struct StablePolicy : SyncedChunkedArrayPolicy {
+    static constexpr const bool stable = true;
+};
+
+// non-movable
+struct Account {
+    std::mutex mutex;
+    int balance;
+    Account(int balance) : balance(balance) {}
+    Account(Account &&) = delete;
+};
+
+void test_stable(){
+    using List = SyncedChunkedArray<Account, 8, StablePolicy>;
+    List list;
+
+    std::vector<List::trackable_iterator> iters;
+    for (int i = 0; i < 40; i++) iters.emplace_back(list.emplace(i)());
+
+    std::vector<Account *> pointers(40);
+    list.iterate([&](auto &&iter) { pointers[(*iter).balance] = &*iter; });
+
+    // erase odd
+    list.iterate([&](auto &&iter) {
+        if ((*iter).balance % 2) list.erase(iter);
+    });
+
+    // survivors did not move
+    bool moved = false;
+    list.iterate([&](auto &&iter) {
+        if (pointers[(*iter).balance] != &*iter) moved = true;
+    });
+
+    // holes reused
+    const std::size_t chunks = list.get_chunks_count();
+    for (int i = 0; i < 20; i++) list.emplace(100 + i);
+
+    int sum = 0;
+    list.iterate([&](auto &&iter) { sum += (*iter).balance; });
+
+    bool tracked;
+    {
+        auto even = iters[10].lock();
+        tracked = even && (*even).balance == 10 && &*even == pointers[10];
+    }
+
+    std::cout << "stable " << (moved ? "moved" : "ok")
+              << " chunks " << chunks << "->" << list.get_chunks_count()
+              << " sum " << sum << " (" << (380 + 2190) << ")"
+              << " tracked " << (tracked ? "ok" : "broken") << std::endl;
+    check(!moved && list.get_chunks_count() == chunks && sum == 2570 && tracked, "stable");
+}
+
+struct SmallPolicy : SyncedChunkedArrayPolicy {
+    static constexpr const std::size_t first_chunk_size = 4;
+};
+
+void test_small_chunks(){
+    using List = SyncedChunkedArray<int, 256, SmallPolicy>;
+    List list;
+
+    auto first = list.emplace(0)();
+    const std::size_t small_capacity = list.metrics().capacity;
+
+    // 4 -> 16 -> 64 -> 256, each outgrown chunk absorbed by next
+    for (int i = 1; i < 100; i++) list.emplace(i);
+    const SyncedChunkedArrayMetrics grown = list.metrics();
+
+    int sum = 0;
+    list.iterate([&](auto &&iter) { sum += *iter; });
+
+    bool tracked;
+    {
+        auto access = first.lock();
+        tracked = access && *access == 0;
+    }
+
+    std::cout << "small chunks capacity " << small_capacity << "->" << grown.capacity
+              << " chunks " << grown.chunks
+              << " sum " << sum << " (" << 4950 << ")"
+              << " tracked " << (tracked ? "ok" : "broken") << std::endl;
+    check(small_capacity == 4 && grown.capacity == 256 && grown.chunks == 1 && sum == 4950 && tracked,
+          "small chunks");
+
+    // budget counts small chunks by their size - full chunk budget fits full chunk of elements
+    List budgeted;
+    budgeted.set_elements_budget(256);
+    std::size_t emplaced = 0;
+    for (int i = 0; i < 300; i++) {
+        if (budgeted.try_emplace(i)) emplaced++;
+    }
+    std::cout << "small chunks budget emplaced " << emplaced << " (256)" << std::endl;
+    check(emplaced == 256, "small chunks budget");
+}
+
+void test_take(){
+    SyncedChunkedArray<int, 64> bag;
+
+    const bool empty_take = !bag.try_take();
+
+    const int producers = 2;
+    const int per_producer = 5000;
+    std::atomic<long long> sum{0};
+    std::atomic<int> consumed{0};
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; p++) {
+        threads.emplace_back([&, p]() {
+            for (int i = 0; i < per_producer; i++) bag.emplace(p * per_producer + i);
+        });
+    }
+    for (int c = 0; c < 2; c++) {
+        threads.emplace_back([&]() {
+            while (consumed < producers * per_producer) {
+                bag.take_batch_wait(16, [&](int &&value) {
+                    sum += value;
+                    consumed++;
+                }, std::chrono::milliseconds(10));
+            }
+        });
+    }
+    for (auto &thread : threads) thread.join();
+
+    const long long total = producers * per_producer;
+    std::cout << "take " << (empty_take ? "ok" : "broken")
+              << " consumed " << consumed << " (" << total << ")"
+              << " sum " << sum << " (" << total * (total - 1) / 2 << ")"
+              << " left " << bag.metrics().elements << " (0)" << std::endl;
+    check(empty_take && consumed == total && sum == total * (total - 1) / 2
+          && bag.metrics().elements == 0, "take");
+}
+
+struct Counter {
+    int id;
+    long hits{0};
+
+    Counter(int id) : id(id) {}
+};
+
+void test_relaxed(){
+    using List = SyncedChunkedArray<Counter, 64>;
+    List list;
+    for (int i = 0; i < 200; i++) list.emplace(i);
+    auto tracked = list.emplace(200)();
+
+    const int threads_count = 4;
+    const int rounds = 100;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threads_count; t++) {
+        threads.emplace_back([&]() {
+            for (int r = 0; r < rounds; r++) {
+                list.iterate_relaxed([&](auto &&view) {
+                    view.atomic(&Counter::hits).fetch_add(1, std::memory_order_relaxed);
+                });
+                auto view = tracked.atomic_view();
+                view.atomic(&Counter::hits).fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+    for (auto &thread : threads) thread.join();
+
+    long sum = 0;
+    long tracked_hits = 0;
+    list.iterate([&](auto &&iter) {
+        sum += (*iter).hits;
+        if ((*iter).id == 200) tracked_hits = (*iter).hits;
+    });
+
+    std::cout << "relaxed sum " << sum << " (" << 201L * threads_count * rounds + threads_count * rounds << ")"
+              << " tracked " << tracked_hits << " (" << 2 * threads_count * rounds << ")" << std::endl;
+    check(sum == 201L * threads_count * rounds + threads_count * rounds
+          && tracked_hits == 2 * threads_count * rounds, "relaxed");
+}
+
+void test_combine(){
+    using List = SyncedChunkedArray<Counter, 64>;
+    List list;
+    for (int i = 0; i < 100; i++) list.emplace(i);
+    auto hot_a = list.emplace(100)();
+    auto hot_b = list.emplace(101)();
+
+    const int threads_count = 4;
+    const int updates = 2000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threads_count; t++) {
+        threads.emplace_back([&, t]() {
+            for (int i = 0; i < updates; i++) {
+                (i + t) % 2 ? hot_a.combine([](Counter &counter) { counter.hits++; })
+                            : hot_b.combine([](Counter &counter) { counter.hits++; });
+            }
+        });
+    }
+    // plain lock holders execute published requests too
+    threads.emplace_back([&]() {
+        for (int i = 0; i < 50; i++) list.iterate([](auto &&) {});
+    });
+    for (auto &thread : threads) thread.join();
+
+    long hits = 0;
+    list.iterate([&](auto &&iter) { hits += (*iter).hits; });
+
+    auto dead = list.emplace(102)();
+    list.erase(dead);
+    const bool dead_combined = dead.combine([](Counter &counter) { counter.hits++; });
+
+    std::cout << "combine hits " << hits << " (" << threads_count * updates << ")"
+              << " dead " << (dead_combined ? "broken" : "ok") << std::endl;
+    check(hits == threads_count * updates && !dead_combined, "combine");
+}
+
+void test_emplace_deferred(){
+    SyncedChunkedArray<int, 16> list;
+    for (int i = 0; i < 100; i++) list.emplace(i);
+
+    // each element spawns one - new ones not visited by the same pass
+    int visited = 0;
+    list.iterate([&](auto &&iter, auto &context) {
+        visited++;
+        context.emplace_deferred(*iter + 1000);
+    });
+
+    int count = 0;
+    long sum = 0;
+    list.iterate([&](auto &&iter) {
+        count++;
+        sum += *iter;
+    });
+
+    std::cout << "emplace_deferred visited " << visited << " (100)"
+              << " count " << count << " (200)"
+              << " sum " << sum << " (" << 4950 * 2 + 100000 << ")" << std::endl;
+    check(visited == 100 && count == 200 && sum == 4950 * 2 + 100000, "emplace_deferred");
+}
+
+struct YieldPolicy : SyncedChunkedArrayPolicy {
+    static constexpr const std::size_t iterate_yield_elements = 1;
+};
+
+void test_iterate_yield(){
+    using List = SyncedChunkedArray<int, 64, YieldPolicy>;
+    List list;
+    for (int i = 0; i < 64; i++) list.emplace(i);
+    auto tracked = list.emplace(64)();
+
+    // slow pass over whole chunk, lookup in the middle of it
+    std::atomic<bool> started{false};
+    int visited = 0;
+    long sum = 0;
+    std::thread iteration([&]() {
+        list.iterate([&](auto &&iter) {
+            started = true;
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            visited++;
+            sum += *iter;
+        });
+    });
+
+    while (!started) std::this_thread::yield();
+    const auto start = std::chrono::steady_clock::now();
+    {
+        auto access = tracked.lock();
+        (*access) += 1000;
+    }
+    const auto waited = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    iteration.join();
+
+    // without yield lookup waits for the rest of chunk - about whole pass
+    std::cout << "iterate yield waited " << waited << "ms (< " << 65 * 2 / 2 << "ms, pass ~" << 65 * 2 << "ms)"
+              << " visited " << visited << " (65)"
+              << " sum " << (sum % 1000) << " (" << (2080 % 1000) << ")" << std::endl;
+    check(waited < 65 * 2 / 2 && visited == 65 && sum % 1000 == 2080 % 1000, "iterate yield");
+}
+
+// Chunk lock recursion is per chunk: holding one chunk, thread must still acquire another.
+void test_recursive_per_chunk(){
+    using List = SyncedChunkedArray<int, 4>;
+    List list;
+    auto first = list.emplace(0)();
+    for (int i = 1; i < 7; i++) list.emplace(i);
+    auto last = list.emplace(7)();      // second chunk
+
+    std::atomic<bool> held{false};
+    std::atomic<bool> release{false};
+    std::thread holder([&]() {
+        auto access = last.lock();
+        held = true;
+        while (!release) std::this_thread::yield();
+    });
+    while (!held) std::this_thread::yield();
+
+    bool other_chunk_acquired;
+    bool same_chunk_reacquired;
+    {
+        auto access = first.lock();
+        other_chunk_acquired = bool(last.try_lock());
+        same_chunk_reacquired = bool(first.try_lock());
+    }
+    release = true;
+    holder.join();
+
+    std::cout << "recursive per chunk: other chunk acquired " << other_chunk_acquired << " (0)"
+              << ", same chunk reacquired " << same_chunk_reacquired << " (1)" << std::endl;
+    check(!other_chunk_acquired && same_chunk_reacquired, "recursive per chunk");
+}
+
+struct Order {
+    int id;
+    int price;
+
+    Order(int id, int price) : id(id), price(price) {}
+};
+struct PriceOf {
+    int operator()(const Order &order) const { return order.price; }
+};
+
+void test_index(){
+    using Orders = SyncedChunkedArray<Order, 32>;
+    Orders orders;
+    SyncedChunkedIndex<PriceOf, Orders> by_price(orders);
+
+    for (int i = 0; i < 1000; i++) by_price.emplace(i, i % 100);
+
+    // cheap prices sold out - compaction relocates the rest
+    by_price.erase_range(0, 49);
+    orders.iterate([](auto &&) {});
+
+    int count = 0;
+    bool in_range = true;
+    by_price.iterate_range(60, 69, [&](auto &&iter) {
+        count++;
+        if ((*iter).price < 60 || (*iter).price > 69) in_range = false;
+    });
+
+    by_price.cleanup();
+
+    std::cout << "index range " << count << " (100)"
+              << " " << (in_range ? "ok" : "broken")
+              << " entries " << by_price.size() << " (500)" << std::endl;
+    check(count == 100 && in_range && by_price.size() == 500, "index");
+}
+
+struct Entity {
+    int id;
+    float x, y;
+
+    Entity(int id, float x, float y) : id(id), x(x), y(y) {}
+};
+struct PositionOf {
+    std::array<float, 2> operator()(const Entity &entity) const { return {entity.x, entity.y}; }
+};
+
+void test_grid(){
+    using Entities = SyncedChunkedArray<Entity, 32>;
+    SyncedChunkedGrid<PositionOf, Entities> grid(10.0f);
+
+    Entities::trackable_iterator far;
+    for (int i = 0; i < 100; i++) {
+        for (int j = 0; j < 100; j++) {
+            auto iter = grid.emplace(i * 100 + j, float(i), float(j));
+            if (i == 90 && j == 90) far = std::move(iter);
+        }
+    }
+
+    auto count_near = [&]() {
+        int count = 0;
+        grid.iterate_region({{15, 15}, {25, 25}}, [&](auto &&) { count++; });
+        return count;
+    };
+    const int before = count_near();
+
+    // walk into region - moved to other cell, tracker follows
+    grid.update(far, [](Entity &entity) { entity.x = 20.5f; entity.y = 20.5f; });
+    const int after = count_near();
+
+    int far_id = -1;
+    if (auto access = far.lock()) far_id = (*access).id;
+
+    std::cout << "grid near " << before << " (121) -> " << after << " (122)"
+              << " tracked " << far_id << " (9090)"
+              << " cells " << grid.cells_count() << " (100)" << std::endl;
+    check(before == 121 && after == 122 && far_id == 9090 && grid.cells_count() == 100, "grid");
+}
+
 int main() {
 
     //reuse_test().run();
     //test_trackable_iterator_erase();
     //test_trackable_iterator_move();
+    test_relocation_hook();
+    test_expire();
+    test_recycle();
+    test_poly();
+    test_join();
+    test_for_each_tracked();
+    test_budget();
+    test_chunk_pool();
+    test_deferred_teardown();
+    test_deferred_teardown_static();
+    test_swap();
+    test_published();
+    test_metrics();
+    test_stable();
+    test_small_chunks();
+    test_take();
+    test_relaxed();
+    test_combine();
+    test_emplace_deferred();
+    test_iterate_yield();
+    test_recursive_per_chunk();
+    test_index();
+    test_grid();
 
-	char ch;
-	std::cin >> ch;
-
-    return 0;
+    return tests_failed ? 1 : 0;
 }
\ No newline at end of file
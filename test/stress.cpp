@@ -0,0 +1,353 @@
+// Concurrency stress: randomised mixed workload on one SyncedChunkedArray from N threads, for fixed duration.
+// Run once per policy (default, small first chunk, iterate yield, stable, recycle, ttl).
+// Verify invariants, report ops/sec per operation. Non-zero exit code on invariant violation.
+//
+//     stress [seconds per policy = 10] [threads = hardware_concurrency] [policy = all]
+//
+// Build with -DSTRESS_TSAN=ON to run under ThreadSanitizer.
+
+#include <iostream>
+#include <iomanip>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+#include <array>
+#include <string>
+#include <cstdlib>
+#include "../SyncedChunkedArray.h"
+
+namespace {
+
+std::atomic<bool> failed{false};
+
+void fail(const std::string &what) {
+    if (!failed.exchange(true)) std::cerr << "INVARIANT VIOLATED: " << what << std::endl;
+}
+
+std::size_t hash(std::size_t id) {
+    return id * 0x9E3779B97F4A7C15ull ^ 0x5851F42D4C957F2Dull;
+}
+
+// count every constructor/destructor, to catch leaks and double destroy
+struct Item {
+    static std::atomic<std::size_t> constructed;
+    static std::atomic<std::size_t> destroyed;
+
+    std::size_t id;
+    std::size_t check;
+
+    Item() : Item(0) {}
+    explicit Item(std::size_t id) : id(id), check(hash(id)) { constructed++; }
+    Item(Item &&other) noexcept : id(other.id), check(other.check) { constructed++; }
+    Item &operator=(Item &&other) noexcept { id = other.id; check = other.check; return *this; }
+    ~Item() { check = 0; destroyed++; }
+
+    bool valid() const { return check == hash(id); }
+
+    // Policy::recycle
+    void reset() { id = 0; check = hash(0); }
+};
+std::atomic<std::size_t> Item::constructed{0};
+std::atomic<std::size_t> Item::destroyed{0};
+
+// Policy::stable - T need not be movable
+struct PinnedItem : Item {
+    using Item::Item;
+    PinnedItem(PinnedItem &&) = delete;
+};
+
+struct StressPolicy : SyncedChunkedArrayPolicy {
+    static std::atomic<std::size_t> relocated;
+
+    template<class T, class Iterator>
+    static void on_relocate(T &element, const Iterator &, const Iterator &) {
+        if (!element.valid()) fail("relocated element corrupted");
+        relocated.fetch_add(1, std::memory_order_relaxed);
+    }
+};
+std::atomic<std::size_t> StressPolicy::relocated{0};
+
+struct SmallPolicy : StressPolicy {
+    static constexpr const std::size_t first_chunk_size = 2;      // small chunks absorption
+};
+struct YieldPolicy : StressPolicy {
+    static constexpr const std::size_t iterate_yield_elements = 4; // mid chunk lock release
+};
+struct StablePolicy : StressPolicy {
+    static constexpr const bool stable = true;
+};
+struct RecyclePolicy : StressPolicy {
+    static constexpr const bool recycle = true;
+};
+struct TtlPolicy : StressPolicy {
+    static constexpr const bool ttl = true;
+};
+
+// small chunks - many of them, so merge/delete/free list are busy
+constexpr const std::size_t chunk_size = 16;
+
+// Population target alternates: grow to hundreds of chunks, then shrink - sparse chunks get merged, deleted,
+// go through free list.
+std::size_t target_size() {
+    const auto phase = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count() / 250;
+    return phase % 2 ? 4096 : 256;
+}
+
+enum Op { op_emplace, op_erase, op_iterate, op_iterate_shared, op_track_lock, op_track_move, op_tracked_erase, op_take,
+          op_combine, op_expire, op_count };
+
+const std::array<const char *, op_count> op_names = {
+    "emplace", "erase (iterate)", "iterate", "iterate_shared",
+    "trackable lock", "trackable move", "erase (for_each_tracked)", "take_batch",
+    "trackable combine", "expire"
+};
+
+template<class Array>
+struct Tracked {
+    typename Array::trackable_iterator iter;
+    std::size_t id;
+};
+
+template<class Array>
+struct Worker {
+    std::array<std::size_t, op_count> ops{};
+    std::size_t emplaced = 0;
+    std::size_t erased = 0;
+    std::vector<Tracked<Array>> tracked;
+};
+
+std::atomic<std::size_t> next_id{1};
+
+template<class Array, class Policy>
+void work(Array &arr, Worker<Array> &worker, std::size_t seed, const std::atomic<bool> &stop) {
+    using T = typename Array::value_type;
+
+    std::mt19937_64 random(seed);
+    const std::size_t max_tracked = 256;
+
+    // keep size around target: per element erase probability grows with size
+    std::size_t target = 0;
+    auto erase_chance = [&](std::size_t size) {
+        return std::uniform_int_distribution<std::size_t>(0, target * target / 4)(random) < size;
+    };
+
+    // other erasers work only above target, to not drain container
+    std::size_t size = 0;
+    for (std::size_t n = 0; !stop.load(std::memory_order_relaxed); n++) {
+        if (n % 64 == 0) {
+            size = arr.metrics().elements;
+            target = target_size();
+        }
+        const int op = std::uniform_int_distribution<int>(0, 99)(random);
+
+        if (op < 50) {
+            const std::size_t id = next_id++;
+            auto emplace = [&]() {
+                if constexpr (Policy::ttl) {
+                    // some die young, by expire()
+                    const auto ttl = std::chrono::milliseconds(std::uniform_int_distribution<int>(0, 3)(random) == 0 ? 5 : 60000);
+                    return arr.emplace_until(Array::clock::now() + ttl, id);
+                } else if constexpr (Policy::recycle) {
+                    return arr.emplace_recycled([&](T &item) { item.id = id; item.check = hash(id); });
+                } else {
+                    return arr.emplace(id);
+                }
+            };
+            auto tracker = emplace();
+            worker.emplaced++;
+            worker.ops[op_emplace]++;
+
+            if (worker.tracked.size() < max_tracked) {
+                worker.tracked.push_back({tracker(), id});
+            }
+        } else if (op < 60) {
+            std::size_t seen = 0;
+            arr.iterate([&](auto &&iter) {
+                if (!(*iter).valid()) fail("iterate: corrupted element");
+                if (erase_chance(size)) {
+                    // keep tracker of erased element: it must go dead, not dangle
+                    if (worker.tracked.size() < max_tracked) {
+                        worker.tracked.push_back({typename Array::trackable_iterator(iter), (*iter).id});
+                    }
+                    arr.erase(iter);
+                    worker.erased++;
+                    worker.ops[op_erase]++;
+                }
+                seen++;
+            });
+            worker.ops[op_iterate] += seen;
+        } else if (op < 65) {
+            std::size_t seen = 0;
+            arr.iterate_shared([&](auto &&iter) {
+                if (!(*iter).valid()) fail("iterate_shared: corrupted element");
+                seen++;
+            });
+            worker.ops[op_iterate_shared] += seen;
+        } else if (op < 80) {
+            if (worker.tracked.empty()) continue;
+            const std::size_t i = std::uniform_int_distribution<std::size_t>(0, worker.tracked.size() - 1)(random);
+            Tracked<Array> &tracked = worker.tracked[i];
+
+            auto verify = [&](auto &&access) {
+                if (!access) return false;
+                if ((*access).id != tracked.id) fail("trackable_iterator points to wrong element");
+                if (!(*access).valid()) fail("trackable_iterator points to corrupted element");
+                return true;
+            };
+            bool dead;
+            if (op < 73) {
+                dead = !verify(tracked.iter.lock());
+                worker.ops[op_track_lock]++;
+            } else if (op < 77) {
+                dead = !verify(tracked.iter.lock_shared());
+                worker.ops[op_track_lock]++;
+            } else {
+                // closure may run on other thread
+                dead = !tracked.iter.combine([&](T &item) {
+                    if (item.id != tracked.id) fail("combine: wrong element");
+                    if (!item.valid()) fail("combine: corrupted element");
+                });
+                worker.ops[op_combine]++;
+            }
+
+            // forget erased
+            if (dead) {
+                tracked = std::move(worker.tracked.back());
+                worker.tracked.pop_back();
+            }
+        } else if (op < 90) {
+            if (worker.tracked.size() < 2) continue;
+            // move through temporary, in random order
+            const std::size_t i = std::uniform_int_distribution<std::size_t>(0, worker.tracked.size() - 1)(random);
+            const std::size_t j = std::uniform_int_distribution<std::size_t>(0, worker.tracked.size() - 1)(random);
+            Tracked<Array> temp = std::move(worker.tracked[i]);
+            worker.tracked[i] = std::move(worker.tracked[j]);
+            worker.tracked[j] = std::move(temp);
+            worker.ops[op_track_move] += 3;
+        } else if (op < 95) {
+            if (worker.tracked.empty() || size < target) continue;
+            // erase a few tracked at once
+            std::vector<const typename Array::trackable_iterator *> targets;
+            const std::size_t count = std::min<std::size_t>(worker.tracked.size(), 8);
+            for (std::size_t i = 0; i < count; i++) {
+                targets.push_back(&worker.tracked[worker.tracked.size() - 1 - i].iter);
+            }
+            arr.for_each_tracked(targets, [&](auto &&iter) {
+                if (!(*iter).valid()) fail("for_each_tracked: corrupted element");
+                arr.erase(iter);
+                worker.erased++;
+                worker.ops[op_tracked_erase]++;
+            });
+            for (std::size_t i = 0; i < count; i++) worker.tracked.pop_back();
+        } else if (op < 98) {
+            if (size < target) continue;
+            arr.take_batch(8, [&](T &&item) {
+                if (!item.valid()) fail("take_batch: corrupted element");
+                worker.erased++;
+                worker.ops[op_take]++;
+            });
+        } else {
+            if constexpr (Policy::ttl) {
+                const std::size_t expired = arr.expire();
+                worker.erased += expired;
+                worker.ops[op_expire] += expired;
+            }
+        }
+    }
+}
+
+template<class Policy, class T = Item>
+void run(const char *name, double seconds, std::size_t threads_count) {
+    using Array = SyncedChunkedArray<T, chunk_size, Policy>;
+
+    std::cout << "-= stress " << name << ": " << threads_count << " threads, " << seconds << " s =-" << std::endl;
+
+    Item::constructed = 0;
+    Item::destroyed = 0;
+    StressPolicy::relocated = 0;
+
+    std::vector<Worker<Array>> workers(threads_count);
+    {
+        Array arr;
+        std::atomic<bool> stop{false};
+
+        const auto start = std::chrono::steady_clock::now();
+        {
+            std::vector<std::thread> threads;
+            for (std::size_t i = 0; i < threads_count; i++) {
+                threads.emplace_back([&, i]() { work<Array, Policy>(arr, workers[i], i + 1, stop); });
+            }
+            std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+            stop = true;
+            for (auto &thread : threads) thread.join();
+        }
+        const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        // throughput
+        std::array<std::size_t, op_count> ops{};
+        std::size_t emplaced = 0;
+        std::size_t erased = 0;
+        for (const Worker<Array> &worker : workers) {
+            for (std::size_t i = 0; i < op_count; i++) ops[i] += worker.ops[i];
+            emplaced += worker.emplaced;
+            erased += worker.erased;
+        }
+        for (std::size_t i = 0; i < op_count; i++) {
+            std::cout << std::setw(26) << std::left << op_names[i] << std::right
+                      << std::fixed << std::setprecision(0) << ops[i] / elapsed << " ops/s" << std::endl;
+        }
+        std::cout << std::defaultfloat;
+
+        const SyncedChunkedArrayMetrics metrics = arr.metrics();
+        std::cout << "relocated: " << StressPolicy::relocated.load()
+                  << " merges: " << metrics.merges << " chunks released: " << metrics.chunks_released << std::endl;
+
+        // conservation: every emplaced element either erased or still there, exactly once
+        std::size_t alive = 0;
+        arr.iterate([&](auto &&iter) {
+            if (!(*iter).valid()) fail("final iterate: corrupted element");
+            alive++;
+        });
+        std::cout << "emplaced: " << emplaced << " erased: " << erased << " alive: " << alive
+                  << " chunks: " << arr.get_chunks_count() << std::endl;
+        if (emplaced != erased + alive) fail("element conservation: emplaced != erased + alive");
+
+        // trackers still valid after all relocations
+        for (Worker<Array> &worker : workers) {
+            for (Tracked<Array> &tracked : worker.tracked) {
+                auto access = tracked.iter.lock();
+                if (access && (*access).id != tracked.id) fail("final: trackable_iterator points to wrong element");
+            }
+            worker.tracked.clear();
+        }
+    }
+
+    // all elements destroyed, exactly once
+    if (Item::constructed != Item::destroyed) fail("constructed != destroyed (leak or double destroy)");
+}
+
+}
+
+int main(int argc, char **argv) {
+    const double seconds = argc > 1 ? std::atof(argv[1]) : 10.0;
+    const std::size_t threads_count = argc > 2
+            ? std::size_t(std::atoi(argv[2]))
+            : std::max<std::size_t>(2, std::thread::hardware_concurrency());
+    const std::string only = argc > 3 ? argv[3] : "";
+
+    auto selected = [&](const char *name) { return only.empty() || only == name; };
+
+    if (selected("default")) run<StressPolicy>("default", seconds, threads_count);
+    if (selected("small"))   run<SmallPolicy>("small", seconds, threads_count);
+    if (selected("yield"))   run<YieldPolicy>("yield", seconds, threads_count);
+    if (selected("stable"))  run<StablePolicy, PinnedItem>("stable", seconds, threads_count);
+    if (selected("recycle")) run<RecyclePolicy>("recycle", seconds, threads_count);
+    if (selected("ttl"))     run<TtlPolicy>("ttl", seconds, threads_count);
+
+    if (failed) return 1;
+    std::cout << "OK" << std::endl;
+    return 0;
+}
@@ -1,7 +1,7 @@
 #pragma once
 
 #include <atomic>
-
+#include <mutex>        // for std::unique_lock
 #include <shared_mutex> // for std::shared_lock
 
 #include "details/SpinLockSpinner.h"
@@ -1,30 +1,37 @@
 #pragma once
 
+#include <atomic>
+#include <cstddef>
+#include <thread>
+
 /// Use as follow:
 ///
 ///     Recursive<SpinLock>
 ///     Recursive<RWSpinLock>
+///
+/// Recursion is per lock instance: thread holding one lock, still have to acquire another.
+/// Owner thread and recursion level kept in the lock itself - not per thread, nor per lock type.
 
 namespace threading{
 
     template<class spin_lock_t>
     class Recursive : public spin_lock_t{
         using Base = spin_lock_t;
-        inline static thread_local std::size_t m_level{0};
+
+        // Written only by owner (set after acquire, cleared before release) - so equals our id only if we own it.
+        std::atomic<std::thread::id> m_owner{};
+        std::size_t m_level{0};                 // owner only
     public:
         using Base::Base;
 
         bool is_locked() const{
-            return m_level>0;
+            return m_owner.load(std::memory_order_relaxed) == std::this_thread::get_id();
         }
 
         bool try_lock(){
-            if (m_level==0) {
-                const bool locked = Base::try_lock();
-                if (locked){
-                    m_level++;
-                }
-                return locked;
+            if (!is_locked()) {
+                if (!Base::try_lock()) return false;
+                m_owner.store(std::this_thread::get_id(), std::memory_order_relaxed);
             }
 
             m_level++;
@@ -32,8 +39,9 @@ namespace threading{
         }
 
         void lock(){
-            if (m_level==0){
+            if (!is_locked()){
                 Base::lock();
+                m_owner.store(std::this_thread::get_id(), std::memory_order_relaxed);
             }
 
             m_level++;
@@ -43,8 +51,10 @@ namespace threading{
         void unlock(){
             m_level--;
 
-            if (m_level==0)
+            if (m_level==0) {
+                m_owner.store(std::thread::id(), std::memory_order_relaxed);
                 Base::unlock();
+            }
         }
     };
 
@@ -1,9 +1,12 @@
 #pragma once
 
 #include <thread>
+#include <mutex>
 
 // std::lock like, accept closures which returns pointers to Lockables, or nullptr
 // return tuple of std::unique_lock
+// Second lock only try-locked. On failure first released, and both pointers re-evaluated.
+// Thus safe, if someone else takes them in reverse order.
 /*
     std::mutex m1, m2;
     bool b;
@@ -43,8 +46,9 @@ namespace threading{
                 return Ret( std::move(lock1), Lock2() );
             }
 
-            Lock2 lock2(*lock_ptr2);
-            if (!lock1){
+            Lock2 lock2(*lock_ptr2, std::try_to_lock);
+            if (!lock2){
+                lock1.unlock();
                 std::this_thread::yield();
                 continue;
             }